@@ -7,6 +7,8 @@
   解放は不要（アプリケーション終了時に自動）
   座標は、OpenSiv3DのVec2の使用を前提（もし、kotsubu_vecのVEC2を使う場合は、この
   ファイル冒頭、またはこのファイルをインクルードする前に、"USE_KOTSUBU_VEC"をdefineしておく）
+  実数はdouble。"USE_KOTSUBU_FLOAT"をdefineしておくと、実数（KotsubuMath::Real）とベクトル
+  （KotsubuMath::Vec2）、図形の構造体、テーブルがすべてfloat（単精度）になる
   その他、一般的な図形の構造体、テーブル引き三角関数、衝突判定、直角三角形の要素を求める、など
 
 ・使い方
@@ -23,10 +25,17 @@
 
 #pragma once
 
-//#define USE_KOTSUBU_VEC  // kotsubu_vecのVEC2を利用するなら定義
+//#define USE_KOTSUBU_VEC    // kotsubu_vecのVEC2を利用するなら定義
+//#define USE_KOTSUBU_FLOAT  // 実数をfloat（単精度）にするなら定義
 
 #include <vector>
 #include <cmath>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#if defined(__AVX2__)
+    #include <immintrin.h>  // 一括判定（PackedLinesなど）をAVX2で行う
+#endif
 #ifdef USE_KOTSUBU_VEC
     #include "kotsubu_vec.h"
 #else
@@ -37,18 +46,128 @@
 
 
 
+///////////////////////////////////////////////////////////////////////////////////////////////
+// 【クラス】KotsubuMathTable
+// KotsubuMathが使う三角関数テーブル。コンパイル時に作成するので、実行時の初期化やロックは不要。
+// 値は<cmath>の代わりに回転の漸化式で求める（constexprの評価ステップ数を抑えるため）
+//
+class KotsubuMathTable
+{
+public:
+    static constexpr double Pi      = 3.141592653589793;
+    static constexpr double Epsilon = 0.00001;  // これ未満を0とする
+
+    static constexpr int SinResolution  = 2000;                                        // 1radあたりの要素数
+    static constexpr int SinTableMax    = static_cast<int>(Pi * SinResolution);        // 0 ～ π
+    static constexpr int SinScaledTwoPi = static_cast<int>(Pi * 2.0 * SinResolution);  // 0 ～ 2π
+    static constexpr int AsinTableMax   = 3000;
+
+    // テーブル本体。線形補間で「次の要素」を読むため、多めに確保する（sinはπちょうどの分も含めて2個）
+    template<typename T> struct SinArray  { T table[SinTableMax + 2]; };
+    template<typename T> struct AsinArray { T table[AsinTableMax + 1]; };
+
+
+    // 【メソッド】sinテーブルを作成（cos兼用）。要素iは sin(i / SinResolution)
+    template<typename T>
+    static constexpr SinArray<T> makeSin()
+    {
+        SinArray<T> result = {};
+        double sinVal = 0.0;
+        double cosVal = 1.0;
+        for (int i = 0; i <= SinTableMax + 1; ++i) {
+            result.table[i] = static_cast<T>((sinVal < Epsilon) ? 0.0 : sinVal);
+            stepRotation(sinVal, cosVal);
+        }
+        return result;
+    }
+
+
+    // 【メソッド】asinテーブルを作成（acos兼用）。要素iは asin(√(i / (AsinTableMax - 1)))
+    // sinの漸化式を0 ～ π/2まで進めながら逆引きし、隣り合う2点を線形補間する
+    template<typename T>
+    static constexpr AsinArray<T> makeAsin()
+    {
+        constexpr int QuarterMax = static_cast<int>(Pi * 0.5 * SinResolution);
+        AsinArray<T> result = {};
+        double max     = AsinTableMax - 1;
+        double lowSin  = 0.0;         // sin(j / SinResolution)
+        double highSin = StepSin;     // sin((j + 1) / SinResolution)
+        double highCos = StepCos;
+        double root    = 0.0;
+        int    j       = 0;
+
+        for (int i = 0; i < AsinTableMax - 1; ++i) {
+            double ratio = i / max;
+            root = sqrtNewton(ratio, root);
+            while (j < QuarterMax - 1 && highSin < root) {
+                lowSin = highSin;
+                stepRotation(highSin, highCos);
+                ++j;
+            }
+            double n = (j + (root - lowSin) / (highSin - lowSin)) / SinResolution;
+            result.table[i] = static_cast<T>((n < Epsilon) ? 0.0 : n);
+        }
+        result.table[AsinTableMax - 1] = static_cast<T>(Pi * 0.5);
+        result.table[AsinTableMax]     = static_cast<T>(Pi * 0.5);
+        return result;
+    }
+
+
+
+private:
+    // 1要素分（1 / SinResolution rad）のsinとcos。テイラー展開
+    static constexpr double Step    = 1.0 / SinResolution;
+    static constexpr double StepSin = Step - Step * Step * Step / 6.0 + Step * Step * Step * Step * Step / 120.0;
+    static constexpr double StepCos = 1.0 - Step * Step / 2.0 + Step * Step * Step * Step / 24.0;
+
+
+    // 【内部メソッド】sinとcosを1要素分進める（加法定理）
+    static constexpr void stepRotation(double& sinVal, double& cosVal)
+    {
+        double nextSin = sinVal * StepCos + cosVal * StepSin;
+        cosVal = cosVal * StepCos - sinVal * StepSin;
+        sinVal = nextSin;
+    }
+
+
+    // 【内部メソッド】平方根（ニュートン法）。guessは前回の結果など、近い値を渡すと早く収束する
+    static constexpr double sqrtNewton(double num, double guess)
+    {
+        if (num <= 0.0) return 0.0;
+        double x = (guess > 0.0) ? guess : num + 1.0;
+        for (int i = 0; i < 64; ++i) {
+            double next = (x + num / x) * 0.5;
+            if (next == x) break;
+            x = next;
+        }
+        return x;
+    }
+};
+
+
+
+
+
 ///////////////////////////////////////////////////////////////////////////////////////////////
 // 【クラス】KotsubuMath
 //
 class KotsubuMath
 {
+public:
+    // 【型】実数とベクトル。USE_KOTSUBU_FLOATの定義でfloat（単精度）となる
+#ifdef USE_KOTSUBU_FLOAT
+    using Real = float;
+#else
+    using Real = double;
+#endif
 #ifdef USE_KOTSUBU_VEC
-    using Vec2 = VEC2<double>;  // kotsubu_vecのVEC2を利用する
+    using Vec2 = VEC2<Real>;  // kotsubu_vecのVEC2を利用する
+#else
+    using Vec2 = s3d::Vector2D<Real>;
 #endif
-    
 
 
-public:
+
     // 【構造体】図形定義用
     struct Line
     {
@@ -59,39 +178,104 @@ public:
 
     struct Rect
     {
-        double left, top, right, bottom;
+        Real left, top, right, bottom;
         Rect() : left(0.0), top(0.0), right(0.0), bottom(0.0) {}
-        Rect(double left, double top, double right, double bottom) : left(left), top(top), right(right), bottom(bottom) {}
+        Rect(Real left, Real top, Real right, Real bottom) : left(left), top(top), right(right), bottom(bottom) {}
     };
 
     struct Circle
     {
         Vec2 pos;
-        double radius;
+        Real radius;
         Circle() : pos(Vec2(0.0, 0.0)), radius(0.0) {}
-        Circle(Vec2 pos, double radius) : pos(pos), radius(radius) {}
+        Circle(Vec2 pos, Real radius) : pos(pos), radius(radius) {}
+    };
+
+
+
+    // 【構造体】一括判定用の図形の配列（成分ごとに連続して並べる。hit.lineOnLinesなどで使う）
+    struct PackedLines
+    {
+        std::vector<Real> startX, startY, endX, endY;
+        size_t size() const { return startX.size(); }
+        void clear()
+        {
+            startX.clear(); startY.clear(); endX.clear(); endY.clear();
+        }
+        void add(Vec2 startPos, Vec2 endPos)
+        {
+            startX.emplace_back(startPos.x); startY.emplace_back(startPos.y);
+            endX.emplace_back(endPos.x);     endY.emplace_back(endPos.y);
+        }
+        void add(const Line& line) { add(line.startPos, line.endPos); }
+    };
+
+    struct PackedRects
+    {
+        std::vector<Real> left, top, right, bottom;
+        size_t size() const { return left.size(); }
+        void clear()
+        {
+            left.clear(); top.clear(); right.clear(); bottom.clear();
+        }
+        void add(Real boxLeft, Real boxTop, Real boxRight, Real boxBottom)
+        {
+            left.emplace_back(boxLeft);   top.emplace_back(boxTop);
+            right.emplace_back(boxRight); bottom.emplace_back(boxBottom);
+        }
+        void add(const Rect& box) { add(box.left, box.top, box.right, box.bottom); }
+    };
+
+    // 凸多角形を「辺の法線と距離」で表したもの。点pは、すべての辺で「normal・p >= offset」なら内側。
+    // 頂点はpointOnPolygonと同じく、右回りで最後に最初の頂点を重ねた（閉じた）もの
+    struct PackedPolygon
+    {
+        std::vector<Real> normalX, normalY, offset;  // 辺ごと
+        Real left, top, right, bottom;               // 外接矩形（先にこれで振り落とす）
+        PackedPolygon() : left(0.0), top(0.0), right(0.0), bottom(0.0) {}
+        explicit PackedPolygon(const std::vector<Vec2>& vertices) { set(vertices); }
+        size_t size() const { return offset.size(); }
+        void set(const std::vector<Vec2>& vertices)
+        {
+            normalX.clear(); normalY.clear(); offset.clear();
+            left = right  = vertices.empty() ? Real(0.0) : vertices[0].x;
+            top  = bottom = vertices.empty() ? Real(0.0) : vertices[0].y;
+            for (size_t i = 0; i + 1 < vertices.size(); ++i) {
+                // outerProduct(辺, p - 始点) = normal・p - normal・始点
+                Vec2 edge(vertices[i + 1] - vertices[i]);
+                Vec2 normal(-edge.y, edge.x);
+                normalX.emplace_back(normal.x);
+                normalY.emplace_back(normal.y);
+                offset.emplace_back(normal.x * vertices[i].x + normal.y * vertices[i].y);
+                left   = std::min(left,   vertices[i + 1].x);
+                right  = std::max(right,  vertices[i + 1].x);
+                top    = std::min(top,    vertices[i + 1].y);
+                bottom = std::max(bottom, vertices[i + 1].y);
+            }
+        }
     };
 
 
 
     // 【定数】数学一般
-    static constexpr double Epsilon    = 0.00001;           // これ未満を0とする
-    static constexpr double Pi         = 3.141592653589793; // π
-    static constexpr double TwoPi      = Pi * 2.0;          // Radianの最大値
-    static constexpr double RightAngle = Pi / 2.0;          // 直角（90°）のRadian
-    static constexpr double Deg2Rad    = Pi / 180.0;        // Degに掛けるとRad
-    static constexpr double Rad2Deg    = 180.0 / Pi;        // Radに掛けるとDeg
-    static constexpr double RootTwo    = 1.414213562373095; // 斜辺が45°の直角三角形における、斜辺の比（他の辺は共に1）
-    static constexpr double RoundFix   = 0.5;               // これを正の小数に足して整数にすると四捨五入
-    static constexpr double One        = 1.0;               // double 1.0
-    static constexpr double Two        = 2.0;               // double 2.0
-    static constexpr double Half       = 0.5;               // double 0.5
+    static constexpr Real Epsilon    = Real(0.00001);             // これ未満を0とする
+    static constexpr Real Pi         = Real(3.141592653589793);   // π
+    static constexpr Real TwoPi      = Pi * Real(2.0);            // Radianの最大値
+    static constexpr Real RightAngle = Pi / Real(2.0);            // 直角（90°）のRadian
+    static constexpr Real Deg2Rad    = Pi / Real(180.0);          // Degに掛けるとRad
+    static constexpr Real Rad2Deg    = Real(180.0) / Pi;          // Radに掛けるとDeg
+    static constexpr Real RootTwo    = Real(1.414213562373095);   // 斜辺が45°の直角三角形における、斜辺の比（他の辺は共に1）
+    static constexpr Real RoundFix   = 0.5;                       // これを正の小数に足して整数にすると四捨五入
+    static constexpr Real One        = 1.0;                       // 1.0
+    static constexpr Real Two        = 2.0;                       // 2.0
+    static constexpr Real Half       = 0.5;                       // 0.5
 
 
 
     // 【メソッド】唯一のインスタンスの参照を返す
     // なるべく計算のロジックに近い所で受け取るようにすると、キャッシュに乗るためか高速化する。
-    // 初回時のみ、インスタンスの生成と、数学用テーブルの作成が行われる
+    // 数学用テーブルはコンパイル時に作成済み。三角関数やdirectionなどはstaticなので、
+    // インスタンスを経由せずに（KotsubuMath::sin(r)など）別スレッドからも呼び出せる
     static KotsubuMath& getInstance()
     {
         static KotsubuMath inst;
@@ -105,23 +289,16 @@ public:
 
     // 【メソッド】sin（テーブル引き）
     // radianに「1周 + 30°」を指定した場合は、周を省いた「30°」で計算する（負数も同様）
-    double sin(double radian)
+    static Real sin(Real radian)
     {
-        int id = std::abs(static_cast<int>(radian * Sin.Resolution)) % Sin.ScaledTwoPi;
-
-        if (id < Sin.TableMax)
-            return (radian < 0.0) ? -Sin.table[id] :  Sin.table[id];
-        else {
-            id -= Sin.TableMax;
-            return (radian < 0.0) ?  Sin.table[id] : -Sin.table[id];
-        }
+        return sinOf(SinTable<Real>, radian);
     }
 
 
 
     // 【メソッド】cos（テーブル引き）
     // radianに「1周 + 30°」を指定した場合は、周を省いた「30°」で計算する（負数も同様）
-    double cos(double radian)
+    static Real cos(Real radian)
     {
         return sin(radian + RightAngle);
     }
@@ -133,12 +310,9 @@ public:
     // ratio >  1  ---  ratioが 1のときの値を返す
     // ratio < -1  ---  ratioが-1のときの値を返す
     // 上記は<cmath>の場合、NaNを返す
-    double asin(double ratio)
+    static Real asin(Real ratio)
     {
-        int id = std::abs(static_cast<int>(ratio * ratio * Asin.TableMax + RoundFix));
-        if (id >= Asin.TableMax) id = Asin.TableMax - 1;
-
-        return (ratio < 0.0) ? -Asin.table[id] : Asin.table[id];
+        return asinOf(AsinTable<Real>, ratio);
     }
 
 
@@ -148,23 +322,79 @@ public:
     // ratio >  1  ---  ratioが 1のときの値を返す
     // ratio < -1  ---  ratioが-1のときの値を返す
     // 上記は<cmath>の場合、NaNを返す
-    double acos(double ratio)
+    static Real acos(Real ratio)
     {
         return RightAngle - asin(ratio);
     }
 
 
 
+    // 【メソッド】float版の三角関数（テーブル引き）
+    // Realがdoubleのときも、float用のテーブル（半分のサイズ）を引く
+    static float sinf(float radian)  { return sinOf(SinTable<float>, radian); }
+    static float cosf(float radian)  { return sinOf(SinTable<float>, radian + static_cast<float>(RightAngle)); }
+    static float asinf(float ratio)  { return asinOf(AsinTable<float>, ratio); }
+    static float acosf(float ratio)  { return static_cast<float>(RightAngle) - asinOf(AsinTable<float>, ratio); }
+
+
+
+    // 【メソッド】線形補間つきの三角関数（テーブル引き）
+    // 隣り合う要素の間を補間するので、通常版より精度が高い（少し重い）
+    static Real sinLerp(Real radian)  { return sinLerpOf(SinTable<Real>, radian); }
+    static Real cosLerp(Real radian)  { return sinLerpOf(SinTable<Real>, radian + RightAngle); }
+    static Real asinLerp(Real ratio)  { return asinLerpOf(AsinTable<Real>, ratio); }
+    static Real acosLerp(Real ratio)  { return RightAngle - asinLerpOf(AsinTable<Real>, ratio); }
+
+
+
+    // 【メソッド】配列版の三角関数（テーブル引き）
+    // radians[0] ～ radians[qty - 1]を計算して、resultsに格納する。分岐の無いループなので、
+    // コンパイラの自動ベクトル化が効きやすい。resultsとradiansは同じ配列でもよい
+    static void sin(const Real* radians, Real* results, size_t qty)
+    {
+        for (size_t i = 0; i < qty; ++i)
+            results[i] = sinOf(SinTable<Real>, radians[i]);
+    }
+
+    static void cos(const Real* radians, Real* results, size_t qty)
+    {
+        for (size_t i = 0; i < qty; ++i)
+            results[i] = sinOf(SinTable<Real>, radians[i] + RightAngle);
+    }
+
+    static void sinCos(const Real* radians, Real* sinResults, Real* cosResults, size_t qty)
+    {
+        for (size_t i = 0; i < qty; ++i) {
+            Real radian   = radians[i];
+            sinResults[i] = sinOf(SinTable<Real>, radian);
+            cosResults[i] = sinOf(SinTable<Real>, radian + RightAngle);
+        }
+    }
+
+    static void sinf(const float* radians, float* results, size_t qty)
+    {
+        for (size_t i = 0; i < qty; ++i)
+            results[i] = sinOf(SinTable<float>, radians[i]);
+    }
+
+    static void cosf(const float* radians, float* results, size_t qty)
+    {
+        for (size_t i = 0; i < qty; ++i)
+            results[i] = sinOf(SinTable<float>, radians[i] + static_cast<float>(RightAngle));
+    }
+
+
+
     // 【メソッド】ベクトルの長さを返す
-    static double length(Vec2 v)
+    static Real length(Vec2 v)
     {
-        return sqrt(lengthPow(v));
+        return std::sqrt(lengthPow(v));
     }
 
 
 
     // 【メソッド】ベクトルの長さを返す（ルートを取らない）
-    static double lengthPow(Vec2 v)
+    static Real lengthPow(Vec2 v)
     {
         return v.x * v.x + v.y * v.y;
     }
@@ -172,15 +402,15 @@ public:
 
 
     // 【メソッド】2点間の距離を返す
-    static double distance(Vec2 a, Vec2 b)
+    static Real distance(Vec2 a, Vec2 b)
     {
-        return sqrt(distancePow(a, b));
+        return std::sqrt(distancePow(a, b));
     }
 
 
 
     // 【メソッド】2点間の距離を返す（ルートを取らない）
-    static double distancePow(Vec2 a, Vec2 b)
+    static Real distancePow(Vec2 a, Vec2 b)
     {
         Vec2 v(a - b);
         return v.x * v.x + v.y * v.y;
@@ -191,7 +421,7 @@ public:
     // 【メソッド】ベクトルを正規化して返す
     static Vec2 normalize(Vec2 v)
     {
-        double len = length(v);
+        Real len = length(v);
         if (len < Epsilon) return v;
 
         return v *= inverseNumber(len);
@@ -200,7 +430,7 @@ public:
 
 
     // 【メソッド】内積を返す
-    static double innerProduct(Vec2 a, Vec2 b)
+    static Real innerProduct(Vec2 a, Vec2 b)
     {
         return a.x * b.x + a.y * b.y;
     }
@@ -208,7 +438,7 @@ public:
 
 
     // 【メソッド】内積を返す（aとスクリーンx）
-    static double innerProduct(Vec2 a)
+    static Real innerProduct(Vec2 a)
     {
         // 基準の軸は、成分x=1,y=0なので、数式がとても簡単
         // return a.x * 1.0 + a.y * 0.0;
@@ -218,7 +448,7 @@ public:
 
 
     // 【メソッド】外積を返す
-    static double outerProduct(Vec2 a, Vec2 b)
+    static Real outerProduct(Vec2 a, Vec2 b)
     {
         return a.x * b.y - b.x * a.y;
     }
@@ -226,7 +456,7 @@ public:
 
 
     // 【メソッド】外積を返す（aとスクリーンx）
-    static double outerProduct(Vec2 a)
+    static Real outerProduct(Vec2 a)
     {
         // 基準の軸は、成分x=1,y=0なので、数式がとても簡単
         // return a.x * 0.0 - 1.0 * a.y;
@@ -236,24 +466,66 @@ public:
 
 
 
+    // 【メソッド】atan2の近似（多項式。テーブルもsqrtも使わない）
+    // ＜戻り値＞ -180°から180°のradian。std::atan2との誤差は最大約1.4e-8（USE_KOTSUBU_FLOATでは、floatの丸めで最大約3e-7）
+    // 引数の順番はstd::atan2と同じ（y, x）。分岐は条件演算子だけなので、配列版は自動ベクトル化が効きやすい
+    static Real atan2Fast(Real y, Real x)
+    {
+        Real absX = std::abs(x);
+        Real absY = std::abs(y);
+        Real maxVal = (absX > absY) ? absX : absY;
+        Real minVal = (absX > absY) ? absY : absX;
+        Real z  = (maxVal > Real(0.0)) ? minVal / maxVal : Real(0.0);
+        Real zz = z * z;
+
+        // 0 ～ 45°のatan（Abramowitz & Stegun 4.4.49）。45°を超える分は、直角からの残りとして求める
+        Real rad = z * (One + zz * (static_cast<Real>(-0.3333314528) + zz * (static_cast<Real>(0.1999355085) +
+                       zz * (static_cast<Real>(-0.1420889944) + zz * (static_cast<Real>(0.1065626393) +
+                       zz * (static_cast<Real>(-0.0752896400) + zz * (static_cast<Real>(0.0429096138) +
+                       zz * (static_cast<Real>(-0.0161657367) + zz *  static_cast<Real>(0.0028662257)))))))));
+        rad = (absY > absX) ? RightAngle - rad : rad;
+        rad = (x < Real(0.0)) ? Pi - rad : rad;
+        return (y < Real(0.0)) ? -rad : rad;
+    }
+
+    // 配列版。results[i] = atan2Fast(ys[i], xs[i])
+    static void atan2Fast(const Real* ys, const Real* xs, Real* results, size_t qty)
+    {
+        for (size_t i = 0; i < qty; ++i)
+            results[i] = atan2Fast(ys[i], xs[i]);
+    }
+
+
+
     // 【メソッド】ベクトルの向きを返す（スクリーン座標系。atan2の代わりに使えて高速）
     // ＜戻り値＞ -180°から180°のradian
-    // 例外以外は、std::atan2に準拠
-    double direction(double vx, double vy)
+    // 長さがEpsilon未満なら0。それ以外は、std::atan2に準拠
+    static Real direction(Real vx, Real vy)
     {
-        double len = sqrt(vx * vx + vy * vy);
-        if (len < Epsilon) return 0.0;
-
-        // 基準の軸は、成分x=1,y=0なので、数式がとても簡単
-        double cosVal = vx / len;  // 「内積/長さ」で余弦値を求める
-        return (vy < 0.0) ? -acos(cosVal) : acos(cosVal);  // 外積を見て、360度角を得る
+        if (vx * vx + vy * vy < Epsilon * Epsilon) return 0.0;
+        return atan2Fast(vy, vx);
     }
 
-    double direction(Vec2 v)
+    static Real direction(Vec2 v)
     {
         return direction(v.x, v.y);
     }
 
+    // 配列版。results[i] = direction(vectors[i])
+    static void directions(const Vec2* vectors, Real* results, size_t qty)
+    {
+        for (size_t i = 0; i < qty; ++i)
+            results[i] = direction(vectors[i].x, vectors[i].y);
+    }
+
+    // 多角形やポリラインの各辺の向き。results[i] = direction(vertices[i + 1] - vertices[i])
+    // resultsには「vertexQty - 1」個を格納する
+    static void edgeDirections(const Vec2* vertices, size_t vertexQty, Real* results)
+    {
+        for (size_t i = 0; i + 1 < vertexQty; ++i)
+            results[i] = direction(vertices[i + 1].x - vertices[i].x, vertices[i + 1].y - vertices[i].y);
+    }
+
 
 
     // 【メソッド】ベクトルaから見た「bの方角」を返す
@@ -264,9 +536,9 @@ public:
     // ・戻り値の範囲違いの類似処理
     // direction(b) - direction(a)  ---  -360°から360°（高速。-10°の方が近くても350°になったりする）
     // fmod(direction(b) - direction(a) + TwoPi, TwoPi)  ---  0°から360°
-    double angle(Vec2 a, Vec2 b)
+    static Real angle(Vec2 a, Vec2 b)
     {
-        double rad = direction(b) - direction(a);
+        Real rad = direction(b) - direction(a);
         if (rad > Pi)
             rad -= TwoPi;  //  200°等であれば-160°とする
         else if (rad < -Pi)
@@ -278,13 +550,13 @@ public:
 
 
     // 【メソッド】ベクトルを回転して返す
-    static Vec2 rotation(Vec2 v, double sinVal, double cosVal)
+    static Vec2 rotation(Vec2 v, Real sinVal, Real cosVal)
     {
         return { v.x * cosVal - v.y * sinVal,
                  v.x * sinVal + v.y * cosVal };
     }
 
-    Vec2 rotation(Vec2 v, double radian)
+    static Vec2 rotation(Vec2 v, Real radian)
     {
         return rotation(v, sin(radian), cos(radian));
     }
@@ -293,7 +565,7 @@ public:
 
     // 【メソッド】反射角を返す
     // ＜引数＞incidenceRadは入射角、reflectionAxisRadは壁となる軸の角度
-    static double reflection(double incidenceRad, double reflectionAxisRad)
+    static Real reflection(Real incidenceRad, Real reflectionAxisRad)
     {
         // 式。「壁となる軸の角度 * 2」から入射角を引く
         return fmod(reflectionAxisRad * Two - incidenceRad, TwoPi);
@@ -303,7 +575,7 @@ public:
 
     // 【メソッド】逆数を返す
     // 「割る数」を「掛ける数」に変換。またはその逆
-    static double inverseNumber(double num)
+    static Real inverseNumber(Real num)
     {
         return One / num;
     }
@@ -312,14 +584,14 @@ public:
 
     // 【メソッド】度数をラジアンに変換
     // 0～2πの範囲に調整する。通常は「degree * KotsubuMath::Deg2Rad」でよい
-    static double toRadian(double degree)
+    static Real toRadian(Real degree)
     {
-        if (degree < 0.0) {
-            degree = fmod(degree, 360.0) + 360.0;
-            if (degree == 360.0) degree = 0.0;
+        if (degree < Real(0.0)) {
+            degree = std::fmod(degree, Real(360.0)) + Real(360.0);
+            if (degree == Real(360.0)) degree = Real(0.0);
         }
-        else if (degree >= 360.0)
-            degree = fmod(degree, 360.0);
+        else if (degree >= Real(360.0))
+            degree = std::fmod(degree, Real(360.0));
 
         return degree * Deg2Rad;
     }
@@ -328,10 +600,10 @@ public:
 
     // 【メソッド】度数の角度範囲をラジアンに変換
     // 0°未満は0、360°より大きいなら2πに制限する
-    static double toRadianRange(double degreeRange)
+    static Real toRadianRange(Real degreeRange)
     {
-        if (degreeRange <   0.0) degreeRange = 0.0;
-        if (degreeRange > 360.0) degreeRange = 360.0;
+        if (degreeRange < Real(  0.0)) degreeRange = Real(  0.0);
+        if (degreeRange > Real(360.0)) degreeRange = Real(360.0);
 
         return degreeRange * Deg2Rad;
     }
@@ -339,13 +611,80 @@ public:
 
 
     // 【メソッド】割った余りを返す（std::fmodより高速）
-    static double fmod(double num, double divNum)
+    static Real fmod(Real num, Real divNum)
     {
         return num - divNum * static_cast<int>(num / divNum);
     }
 
 
 
+    // 【メソッド】放射状の力（一括）。中心からの距離で弱まる力を、点ごとの速度変化に加える
+    // 強さは「power * (1 - 距離 / radius)^falloff」で、向きは中心へ（isVortexなら、それを90°回した向き）。
+    // 半径の外と中心に重なった点は対象外。AVX2が使えて、falloffが1か2なら、doubleなら4個、floatなら8個ずつ計算する
+    // ＜引数＞
+    // xs, ys   --- 点の座標
+    // qty      --- 点の数
+    // center   --- 中心
+    // radius   --- 半径
+    // power    --- 中心での強さ
+    // falloff  --- 減衰の指数
+    // isVortex --- trueなら渦（画面はy軸が下向きなので、powerが正なら時計回り）
+    // dvxs, dvys --- 速度変化（加算する）
+    // hits     --- 力を受けた点は1にする
+    static void radialForces(const Real* xs, const Real* ys, size_t qty, Vec2 center, Real radius, Real power,
+                             Real falloff, bool isVortex, Real* dvxs, Real* dvys, std::uint8_t* hits)
+    {
+        Real   radiusPow = radius * radius;
+        Real   invRadius = One / radius;
+        size_t i         = 0;
+#if defined(__AVX2__)
+        if ((falloff == One) || (falloff == Two)) {
+            Simd::Reg cx = Simd::set(center.x), cy = Simd::set(center.y);
+            Simd::Reg r2 = Simd::set(radiusPow), eps = Simd::set(static_cast<Real>(Epsilon));
+            Simd::Reg invR = Simd::set(invRadius), one = Simd::set(One), pw = Simd::set(power);
+            for (; i + Simd::Width <= qty; i += Simd::Width) {
+                Simd::Reg vx   = Simd::sub(cx, Simd::load(&xs[i]));
+                Simd::Reg vy   = Simd::sub(cy, Simd::load(&ys[i]));
+                Simd::Reg d2   = Simd::add(Simd::mul(vx, vx), Simd::mul(vy, vy));
+                Simd::Reg ok   = Simd::both(Simd::less(d2, r2), Simd::lessEq(eps, d2));
+                int       mask = Simd::mask(ok);
+                if (!mask) continue;
+                Simd::Reg dist = Simd::sqrt(d2);
+                Simd::Reg w    = Simd::sub(one, Simd::mul(dist, invR));
+                if (falloff == Two) w = Simd::mul(w, w);
+                Simd::Reg rate = Simd::both(ok, Simd::div(Simd::mul(pw, w), dist));  // 対象外は0（中心の0除算も消える）
+                Simd::Reg ax   = isVortex ? vy : vx;
+                Simd::Reg ay   = isVortex ? Simd::sub(Simd::set(Real(0)), vx) : vy;
+                Simd::store(&dvxs[i], Simd::add(Simd::load(&dvxs[i]), Simd::mul(ax, rate)));
+                Simd::store(&dvys[i], Simd::add(Simd::load(&dvys[i]), Simd::mul(ay, rate)));
+                for (int k = 0; k < Simd::Width; ++k)
+                    hits[i + k] |= static_cast<std::uint8_t>((mask >> k) & 1);
+            }
+        }
+#endif
+        for (; i < qty; ++i) {
+            Real vx = center.x - xs[i];
+            Real vy = center.y - ys[i];
+            Real distPow = vx * vx + vy * vy;
+            if (distPow >= radiusPow || distPow < Epsilon) continue;
+            Real dist = std::sqrt(distPow);
+            Real w    = One - dist * invRadius;
+            if (falloff != One) w = std::pow(w, falloff);
+            Real rate = power * w / dist;
+            if (isVortex) {
+                dvxs[i] += vy * rate;
+                dvys[i] -= vx * rate;
+            }
+            else {
+                dvxs[i] += vx * rate;
+                dvys[i] += vy * rate;
+            }
+            hits[i] = 1;
+        }
+    }
+
+
+
 
 
     ////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -358,9 +697,9 @@ public:
     public:
         // 【メソッド】斜辺の長さを返す（三平方の定理）
         // ＜引数＞ 底辺の長さ、高さ
-        static double hypotLen(double baseLen, double height)
+        static Real hypotLen(Real baseLen, Real height)
         {
-            return sqrt(baseLen * baseLen + height * height);
+            return std::sqrt(baseLen * baseLen + height * height);
         }
 
 
@@ -370,12 +709,12 @@ public:
         // ＜引数＞ 斜辺ab、底辺bcの座標（底辺の長さは適当でよい）
         // 頂点abcの関係が「鈍角（90°以上）」のときは、通常の直角三角形は定義できない。
         // その場合は、直線bc上に「反転された直角三角形」を形成して結果を求める。
-        static double baseLen(Vec2 a, Vec2 b, Vec2 c)
+        static Real baseLen(Vec2 a, Vec2 b, Vec2 c)
         {
             // ふつうの三角形を定義
             Vec2 abV(a - b);             // 斜辺ベクトル
             Vec2 bcV(c - b);             // 底辺ベクトル
-            double bcLen = length(bcV);  // 底辺の長さ（まだ直角三角形にしたときの底辺は不明）
+            Real bcLen = length(bcV);  // 底辺の長さ（まだ直角三角形にしたときの底辺は不明）
             if (bcLen < Epsilon) return 0.0;
 
             // 直角三角形の底辺長 = abとbcの内積を、bc長で割る。
@@ -391,12 +730,12 @@ public:
         // ＜引数＞ 斜辺abの座標、傾き（radian）
         // 傾きは、通常±90°未満を指定する。正で反時計回り、負で時計回りの図形となる。
         // また、±90°を超えると「高さの辺」が斜辺をまたいで図形が反転する。
-        double baseLen(Vec2 a, Vec2 b, double bAngle)
+        Real baseLen(Vec2 a, Vec2 b, Real bAngle)
         {
             KotsubuMath& math = getInstance();  // 親クラスの静的ではないメソッドを利用する
             Vec2   abV(a - b);                                  // 斜辺ベクトル
-            double abDir = math.direction(abV);                 // 斜辺の傾き
-            double bcDir = abDir + bAngle;                      // 底辺の傾き
+            Real   abDir = math.direction(abV);                 // 斜辺の傾き
+            Real   bcDir = abDir + bAngle;                      // 底辺の傾き
             Vec2   bcNormal(math.cos(bcDir), math.sin(bcDir));  // 底辺の正規化ベクトル
 
             // 直角三角形の底辺長 = abと正規化bcの内積。
@@ -412,12 +751,12 @@ public:
         // ＜引数＞ 斜辺ab、底辺bcの座標（底辺の長さは適当でよい）
         // 頂点abcの関係が「鈍角（90°以上）」のときは、通常の直角三角形は定義できない。
         // その場合は、直線bc上に「反転された直角三角形」を形成して結果を求める。
-        static double height(Vec2 a, Vec2 b, Vec2 c)
+        static Real height(Vec2 a, Vec2 b, Vec2 c)
         {
             // ふつうの三角形を定義
             Vec2 abV(a - b);             // 斜辺ベクトル
             Vec2 bcV(c - b);             // 底辺ベクトル
-            double bcLen = length(bcV);  // 底辺の長さ
+            Real bcLen = length(bcV);  // 底辺の長さ
             if (bcLen < Epsilon) return 0.0;
 
             // 直角三角形の高さ = abとbcの外積を、bc長で割る。
@@ -433,12 +772,12 @@ public:
         // ＜引数＞ 斜辺abの座標、傾き（radian）
         // 傾きは、通常±90°未満を指定する。正で反時計回り、負で時計回りの図形となる。
         // また、±90°を超えると「高さの辺」が斜辺をまたいで図形が反転する。
-        double height(Vec2 a, Vec2 b, double bAngle)
+        Real height(Vec2 a, Vec2 b, Real bAngle)
         {
             KotsubuMath& math = getInstance();  // 親クラスの静的ではないメソッドを利用する
             Vec2   abV(a - b);                                  // 斜辺ベクトル
-            double abDir = math.direction(abV);                 // 斜辺の傾き
-            double bcDir = abDir + bAngle;                      // 底辺の傾き
+            Real   abDir = math.direction(abV);                 // 斜辺の傾き
+            Real   bcDir = abDir + bAngle;                      // 底辺の傾き
             Vec2   bcNormal(math.cos(bcDir), math.sin(bcDir));  // 底辺の正規化ベクトル
 
             // 直角三角形の高さ = abと正規化bcの外積。
@@ -460,7 +799,7 @@ public:
             // ふつうの三角形を定義
             Vec2 abV(a - b);             // 斜辺ベクトル
             Vec2 bcV(c - b);             // 底辺ベクトル
-            double bcLen = length(bcV);  // 底辺の長さ（まだ直角三角形にしたときの底辺は不明）
+            Real bcLen = length(bcV);  // 底辺の長さ（まだ直角三角形にしたときの底辺は不明）
             if (bcLen < Epsilon) return b;  // 底辺の長さが0の場合は「頂点b = 底辺終点」となる
 
             // 底辺終点 = 底辺始点 + 底辺ベクトル * その割合
@@ -475,12 +814,12 @@ public:
         // ＜引数＞ 斜辺abの座標、傾き（radian）
         // 傾きは、通常±90°未満を指定する。正で反時計回り、負で時計回りの図形となる。
         // また、±90°を超えると「高さの辺」が斜辺をまたいで図形が反転する。
-        Vec2 baseEndPos(Vec2 a, Vec2 b, double bAngle)
+        Vec2 baseEndPos(Vec2 a, Vec2 b, Real bAngle)
         {
             KotsubuMath& math = getInstance();  // 親クラスの静的ではないメソッドを利用する
             Vec2   abV(a - b);                                  // 斜辺ベクトル
-            double abDir = math.direction(abV);                 // 斜辺の傾き
-            double bcDir = abDir + bAngle;                      // 底辺の傾き
+            Real   abDir = math.direction(abV);                 // 斜辺の傾き
+            Real   bcDir = abDir + bAngle;                      // 底辺の傾き
             Vec2   bcNormal(math.cos(bcDir), math.sin(bcDir));  // 底辺の正規化ベクトル
 
             // 底辺終点 = 底辺始点 + 底辺の正規化ベクトル * その長さ
@@ -492,7 +831,7 @@ public:
         // 【メソッド】斜辺と底辺のなす角（∠b）を返す
         // ＜引数＞ 斜辺ab、底辺bcの座標（それぞれ長さは適当でよい）
         // ＜戻り値＞ ±180°以下の数。図形が反時計回りのときは正、時計回りのときは負
-        double angleB(Vec2 a, Vec2 b, Vec2 c)
+        Real angleB(Vec2 a, Vec2 b, Vec2 c)
         {
             KotsubuMath& math = getInstance();  // 親クラスの静的ではないメソッドを利用する
             Vec2 abV(a - b);  // 斜辺ベクトル
@@ -519,20 +858,20 @@ public:
         // 交点が線分上にあるなら、垂線の長さが「最短距離」となる。
         // 線分上に無いなら、近いほうの線分端までが「最短距離」となる。
         // これは、戻り値が「ある半径以内」かどうかを見て「円と線分の衝突判定」に利用できる
-        static double distance(Vec2 point, Line line)
+        static Real distance(Vec2 point, Line line)
         {
             Vec2   lineV(line.endPos - line.startPos);
-            double lineLen = length(lineV);
+            Real lineLen = length(lineV);
             // 線分が短すぎる場合は、正常な計算ができない。点⇔線分始点の距離を返して終了
             if (lineLen < Epsilon)
                 return KotsubuMath::distance(point, line.startPos);
 
             // 点⇔線分始点を結ぶ辺が「鈍角」なら、始点が最も近い
-            if (innerProduct(point - line.startPos, lineV) < 0.0)
+            if (innerProduct(point - line.startPos, lineV) < Real(0.0))
                 return KotsubuMath::distance(point, line.startPos);
 
             // 点⇔線分終点を結ぶ辺が「鋭角」なら、終点が最も近い
-            if (innerProduct(point - line.endPos, lineV) >= 0.0)
+            if (innerProduct(point - line.endPos, lineV) >= Real(0.0))
                 return KotsubuMath::distance(point, line.endPos);
             
             // 上記以外（交点が線分上にある）なら、垂線の長さが最短距離
@@ -582,8 +921,8 @@ public:
             // 上記1と2を満たすとき、交差している。
             // 「直線ABと頂点Cの外積 * 直線ABと頂点Dの外積」で、直線ABに線分CDがまたいでいるかが分かる。
             // 「正*正>0, 正*負<0, 負*負>0」の性質を利用している（左側と右側が入れ替わっても同じ）
-            return (outerProduct(vecAB, vecAC) * outerProduct(vecAB, vecAD) < 0.0) &&
-                   (outerProduct(vecCD, vecCA) * outerProduct(vecCD, vecCB) < 0.0);
+            return (outerProduct(vecAB, vecAC) * outerProduct(vecAB, vecAD) < Real(0.0)) &&
+                   (outerProduct(vecCD, vecCA) * outerProduct(vecCD, vecCB) < Real(0.0));
         }
 
         static bool lineOnLine(Line lineA, Line lineB)
@@ -598,11 +937,11 @@ public:
         // lineStartY  --- 線分の始点y
         // lineEndY    --- 線分の終点y
         // horizontalY --- 横軸のy座標
-        static bool lineOnHorizontal(double lineStartY, double lineEndY, double horizontalY)
+        static bool lineOnHorizontal(Real lineStartY, Real lineEndY, Real horizontalY)
         {
-            double a = horizontalY - lineStartY;
-            double b = horizontalY - lineEndY;
-            return a * b < 0.0;
+            Real a = horizontalY - lineStartY;
+            Real b = horizontalY - lineEndY;
+            return a * b < Real(0.0);
         }
 
 
@@ -612,11 +951,11 @@ public:
         // lineStartX --- 線分の始点x
         // lineEndX   --- 線分の終点x
         // verticalX  --- 縦軸のx座標
-        static bool lineOnVertical(double lineStartX, double lineEndX, double verticalX)
+        static bool lineOnVertical(Real lineStartX, Real lineEndX, Real verticalX)
         {
-            double a = verticalX - lineStartX;
-            double b = verticalX - lineEndX;
-            return a * b < 0.0;
+            Real a = verticalX - lineStartX;
+            Real b = verticalX - lineEndX;
+            return a * b < Real(0.0);
         }
 
 
@@ -625,7 +964,7 @@ public:
         // ＜引数＞
         // point --- 点の座標
         // boxLeft, boxTop, boxRight, boxBottom --- 矩形の座標
-        static bool pointOnBox(Vec2 point, double boxLeft, double boxTop, double boxRight, double boxBottom)
+        static bool pointOnBox(Vec2 point, Real boxLeft, Real boxTop, Real boxRight, Real boxBottom)
         {
             return (point.x >= boxLeft) && (point.y >= boxTop) &&
                    (point.x < boxRight) && (point.y < boxBottom);
@@ -650,12 +989,228 @@ public:
             // 頂点nと頂点n+1を結ぶ辺から見て、点が「左側」にあった時点で判定をやめる
             for (int i = 0, edgeQty = vertices.size() - 1; i < edgeQty; ++i) {
                 Line edge(vertices[i], vertices[i + 1]);
-                if (outerProduct(edge.endPos - edge.startPos, point - edge.startPos) < 0.0)
+                if (outerProduct(edge.endPos - edge.startPos, point - edge.startPos) < Real(0.0))
+                    return false;
+            }
+            return true;
+        }
+
+
+
+        // 【メソッド】内包判定。点と多角形（PackedPolygon版）
+        // 外接矩形の外なら辺を見ずに終わるので、大きな多角形でも大半の点は4回の比較で済む
+        static bool pointOnPolygon(Vec2 point, const PackedPolygon& polygon)
+        {
+            if (point.x < polygon.left || point.x > polygon.right ||
+                point.y < polygon.top  || point.y > polygon.bottom)
+                return false;
+
+            for (size_t i = 0, edgeQty = polygon.size(); i < edgeQty; ++i) {
+                if (polygon.normalX[i] * point.x + polygon.normalY[i] * point.y < polygon.offset[i])
                     return false;
             }
             return true;
         }
 
+
+
+        // 【メソッド】内包判定（一括）。点の配列と多角形
+        // 点を64個ずつのブロックに分け、AVX2が使えるときはさらにdoubleなら4個、floatなら8個ずつ判定する。
+        // ブロック内の点がすべて外側と分かった辺で打ち切る
+        // ＜引数＞
+        // xs, ys  --- 点の座標（成分ごとの配列。qty個）
+        // polygon --- 多角形
+        // masks   --- 結果。点iが内側なら「masks[i / 64]」の「i % 64」ビット目が1
+        static void pointsOnPolygonMask(const Real* xs, const Real* ys, size_t qty, const PackedPolygon& polygon,
+                                        std::vector<std::uint64_t>& masks)
+        {
+            masks.assign((qty + 63) / 64, 0);
+            for (size_t block = 0; block < qty; block += 64) {
+                size_t blockEnd = std::min(block + 64, qty);
+                size_t i = block;
+#if defined(__AVX2__)
+                for (; i + Simd::Width <= blockEnd; i += Simd::Width) {
+                    std::uint64_t mask = static_cast<std::uint64_t>(pointsOnPolygonBlock(&xs[i], &ys[i], polygon));
+                    masks[i / 64] |= mask << (i % 64);
+                }
+#endif
+                for (; i < blockEnd; ++i) {
+                    if (pointOnPolygon(Vec2(xs[i], ys[i]), polygon))
+                        masks[i / 64] |= std::uint64_t(1) << (i % 64);
+                }
+            }
+        }
+
+
+
+        // 【メソッド】交差判定（一括）。線分1本と、線分の配列
+        // AVX2が使えるときは、doubleなら4本、floatなら8本ずつまとめて判定する
+        // ＜引数＞
+        // posC  --- 線分の始点（粒子の移動前の位置など）
+        // posD  --- 線分の終点（粒子の移動後の位置など）
+        // lines --- 判定する線分の配列
+        // ＜戻り値＞ 交差した線分のうち、最も小さい添え字。どれとも交差しなければ-1
+        static int lineOnLines(Vec2 posC, Vec2 posD, const PackedLines& lines)
+        {
+            size_t qty = lines.size();
+            size_t i   = 0;
+#if defined(__AVX2__)
+            for (; i + Simd::Width <= qty; i += Simd::Width) {
+                int mask = lineOnLinesBlock(posC, posD, lines, i);
+                if (mask) return static_cast<int>(i) + lowestBit(mask);
+            }
+#endif
+            for (; i < qty; ++i) {
+                if (lineOnLineAt(posC, posD, lines, i))
+                    return static_cast<int>(i);
+            }
+            return -1;
+        }
+
+
+        // 【メソッド】交差判定（一括）。線分1本と、線分の配列。すべての結果をビットで返す
+        // ＜引数＞ masks --- 結果。lines[i]と交差していれば「masks[i / 64]」の「i % 64」ビット目が1
+        static void lineOnLinesMask(Vec2 posC, Vec2 posD, const PackedLines& lines, std::vector<std::uint64_t>& masks)
+        {
+            size_t qty = lines.size();
+            size_t i   = 0;
+            masks.assign((qty + 63) / 64, 0);
+#if defined(__AVX2__)
+            for (; i + Simd::Width <= qty; i += Simd::Width) {
+                std::uint64_t mask = static_cast<std::uint64_t>(lineOnLinesBlock(posC, posD, lines, i));
+                masks[i / 64] |= mask << (i % 64);  // Widthは64の約数なので、ブロックが語をまたがない
+            }
+#endif
+            for (; i < qty; ++i) {
+                if (lineOnLineAt(posC, posD, lines, i))
+                    masks[i / 64] |= std::uint64_t(1) << (i % 64);
+            }
+        }
+
+
+        // 【メソッド】内包判定（一括）。点と矩形の配列
+        // ＜戻り値＞ 点を含む矩形のうち、最も小さい添え字。どれにも含まれなければ-1
+        static int pointOnBoxes(Vec2 point, const PackedRects& boxes)
+        {
+            size_t qty = boxes.size();
+            size_t i   = 0;
+#if defined(__AVX2__)
+            for (; i + Simd::Width <= qty; i += Simd::Width) {
+                int mask = pointOnBoxesBlock(point, boxes, i);
+                if (mask) return static_cast<int>(i) + lowestBit(mask);
+            }
+#endif
+            for (; i < qty; ++i) {
+                if (pointOnBox(point, boxes.left[i], boxes.top[i], boxes.right[i], boxes.bottom[i]))
+                    return static_cast<int>(i);
+            }
+            return -1;
+        }
+
+
+        // 【メソッド】内包判定（一括）。点と矩形の配列。すべての結果をビットで返す
+        // ＜引数＞ masks --- 結果。boxes[i]に含まれていれば「masks[i / 64]」の「i % 64」ビット目が1
+        static void pointOnBoxesMask(Vec2 point, const PackedRects& boxes, std::vector<std::uint64_t>& masks)
+        {
+            size_t qty = boxes.size();
+            size_t i   = 0;
+            masks.assign((qty + 63) / 64, 0);
+#if defined(__AVX2__)
+            for (; i + Simd::Width <= qty; i += Simd::Width) {
+                std::uint64_t mask = static_cast<std::uint64_t>(pointOnBoxesBlock(point, boxes, i));
+                masks[i / 64] |= mask << (i % 64);
+            }
+#endif
+            for (; i < qty; ++i) {
+                if (pointOnBox(point, boxes.left[i], boxes.top[i], boxes.right[i], boxes.bottom[i]))
+                    masks[i / 64] |= std::uint64_t(1) << (i % 64);
+            }
+        }
+
+
+
+    private:
+        // 【内部メソッド】lineOnLineと同じ判定を、配列のi番目の線分に対して行う
+        static bool lineOnLineAt(Vec2 posC, Vec2 posD, const PackedLines& lines, size_t i)
+        {
+            Vec2 posA(lines.startX[i], lines.startY[i]);
+            Vec2 posB(lines.endX[i],   lines.endY[i]);
+            return lineOnLine(posA, posB, posC, posD);
+        }
+
+
+        // 【内部メソッド】最下位の1のビット位置（maskは0以外）
+        static int lowestBit(int mask)
+        {
+            int n = 0;
+            while (!(mask & 1)) {
+                mask >>= 1;
+                ++n;
+            }
+            return n;
+        }
+
+
+#if defined(__AVX2__)
+        // 【内部メソッド】lines[i] ～ lines[i + Width - 1]とlineOnLineを行い、結果をビットで返す
+        static int lineOnLinesBlock(Vec2 posC, Vec2 posD, const PackedLines& lines, size_t i)
+        {
+            using R = Simd::Reg;
+            R ax = Simd::load(&lines.startX[i]);
+            R ay = Simd::load(&lines.startY[i]);
+            R bx = Simd::load(&lines.endX[i]);
+            R by = Simd::load(&lines.endY[i]);
+            R cx = Simd::set(posC.x);
+            R cy = Simd::set(posC.y);
+            R dx = Simd::set(posD.x);
+            R dy = Simd::set(posD.y);
+            R abx = Simd::sub(bx, ax);
+            R aby = Simd::sub(by, ay);
+            R cdx = Simd::set(posD.x - posC.x);
+            R cdy = Simd::set(posD.y - posC.y);
+
+            // lineOnLineと同じ式。直線ABが線分CDを、直線CDが線分ABをまたいでいれば交差
+            R abc = Simd::cross(abx, aby, Simd::sub(cx, ax), Simd::sub(cy, ay));
+            R abd = Simd::cross(abx, aby, Simd::sub(dx, ax), Simd::sub(dy, ay));
+            R cda = Simd::cross(cdx, cdy, Simd::sub(ax, cx), Simd::sub(ay, cy));
+            R cdb = Simd::cross(cdx, cdy, Simd::sub(bx, cx), Simd::sub(by, cy));
+            R zero = Simd::set(0.0);
+            return Simd::mask(Simd::both(Simd::less(Simd::mul(abc, abd), zero),
+                                         Simd::less(Simd::mul(cda, cdb), zero)));
+        }
+
+
+        // 【内部メソッド】boxes[i] ～ boxes[i + Width - 1]とpointOnBoxを行い、結果をビットで返す
+        static int pointOnBoxesBlock(Vec2 point, const PackedRects& boxes, size_t i)
+        {
+            using R = Simd::Reg;
+            R px = Simd::set(point.x);
+            R py = Simd::set(point.y);
+            R inX = Simd::both(Simd::lessEq(Simd::load(&boxes.left[i]), px), Simd::less(px, Simd::load(&boxes.right[i])));
+            R inY = Simd::both(Simd::lessEq(Simd::load(&boxes.top[i]),  py), Simd::less(py, Simd::load(&boxes.bottom[i])));
+            return Simd::mask(Simd::both(inX, inY));
+        }
+
+
+        // 【内部メソッド】点xs[0] ～ xs[Width - 1]とpointOnPolygonを行い、結果をビットで返す
+        static int pointsOnPolygonBlock(const Real* xs, const Real* ys, const PackedPolygon& polygon)
+        {
+            using R = Simd::Reg;
+            R px = Simd::load(xs);
+            R py = Simd::load(ys);
+            R inX = Simd::both(Simd::lessEq(Simd::set(polygon.left), px), Simd::lessEq(px, Simd::set(polygon.right)));
+            R inY = Simd::both(Simd::lessEq(Simd::set(polygon.top),  py), Simd::lessEq(py, Simd::set(polygon.bottom)));
+            R inside = Simd::both(inX, inY);
+
+            for (size_t i = 0, edgeQty = polygon.size(); i < edgeQty; ++i) {
+                if (!Simd::mask(inside)) break;  // すべて外側
+                R dot = Simd::add(Simd::mul(Simd::set(polygon.normalX[i]), px), Simd::mul(Simd::set(polygon.normalY[i]), py));
+                inside = Simd::both(inside, Simd::lessEq(Simd::set(polygon.offset[i]), dot));
+            }
+            return Simd::mask(inside);
+        }
+#endif
+
     } hit;
 
 
@@ -663,43 +1218,115 @@ public:
 
 
 private:
-    // 【構造体】テーブル用
-    struct SinTable
+#if defined(__AVX2__)
+    // 【内部構造体】AVX2の命令を、Realの型に合わせて選ぶ（doubleなら4個、floatなら8個ずつ処理）
+    struct Simd
+    {
+    #ifdef USE_KOTSUBU_FLOAT
+        using Reg = __m256;
+        static constexpr int Width = 8;
+        static Reg load(const Real* p)     { return _mm256_loadu_ps(p); }
+        static void store(Real* p, Reg a)  { _mm256_storeu_ps(p, a); }
+        static Reg set(Real v)             { return _mm256_set1_ps(v); }
+        static Reg add(Reg a, Reg b)       { return _mm256_add_ps(a, b); }
+        static Reg sub(Reg a, Reg b)       { return _mm256_sub_ps(a, b); }
+        static Reg mul(Reg a, Reg b)       { return _mm256_mul_ps(a, b); }
+        static Reg div(Reg a, Reg b)       { return _mm256_div_ps(a, b); }
+        static Reg sqrt(Reg a)             { return _mm256_sqrt_ps(a); }
+        static Reg less(Reg a, Reg b)      { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+        static Reg lessEq(Reg a, Reg b)    { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+        static Reg both(Reg a, Reg b)      { return _mm256_and_ps(a, b); }
+        static int mask(Reg a)             { return _mm256_movemask_ps(a); }
+    #else
+        using Reg = __m256d;
+        static constexpr int Width = 4;
+        static Reg load(const Real* p)     { return _mm256_loadu_pd(p); }
+        static void store(Real* p, Reg a)  { _mm256_storeu_pd(p, a); }
+        static Reg set(Real v)             { return _mm256_set1_pd(v); }
+        static Reg add(Reg a, Reg b)       { return _mm256_add_pd(a, b); }
+        static Reg sub(Reg a, Reg b)       { return _mm256_sub_pd(a, b); }
+        static Reg mul(Reg a, Reg b)       { return _mm256_mul_pd(a, b); }
+        static Reg div(Reg a, Reg b)       { return _mm256_div_pd(a, b); }
+        static Reg sqrt(Reg a)             { return _mm256_sqrt_pd(a); }
+        static Reg less(Reg a, Reg b)      { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+        static Reg lessEq(Reg a, Reg b)    { return _mm256_cmp_pd(a, b, _CMP_LE_OQ); }
+        static Reg both(Reg a, Reg b)      { return _mm256_and_pd(a, b); }
+        static int mask(Reg a)             { return _mm256_movemask_pd(a); }
+    #endif
+        // 外積（outerProductと同じ式）
+        static Reg cross(Reg ax, Reg ay, Reg bx, Reg by) { return sub(mul(ax, by), mul(bx, ay)); }
+    };
+#endif
+
+
+
+    // 【内部フィールド】テーブル（コンパイル時に作成。型ごとに1つ）
+    template<typename T>
+    static constexpr KotsubuMathTable::SinArray<T>  SinTable  = KotsubuMathTable::makeSin<T>();
+    template<typename T>
+    static constexpr KotsubuMathTable::AsinArray<T> AsinTable = KotsubuMathTable::makeAsin<T>();
+
+
+
+    // 【内部メソッド】テーブル引きの本体（型はRealまたはfloat）
+    template<typename T>
+    static T sinOf(const KotsubuMathTable::SinArray<T>& sinTable, T radian)
     {
-        static constexpr int Resolution  = 2000;
-        static constexpr int TableMax    = static_cast<int>(Pi * Resolution);
-        static constexpr int ScaledTwoPi = static_cast<int>(TwoPi * Resolution);
-        double table[TableMax];
-    } Sin;
+        int id = std::abs(static_cast<int>(radian * KotsubuMathTable::SinResolution)) % KotsubuMathTable::SinScaledTwoPi;
+
+        // 後半（π ～ 2π）は前半の符号を反転したもの。負数はさらに反転する
+        bool isLatter = (id >= KotsubuMathTable::SinTableMax);
+        if (isLatter) id -= KotsubuMathTable::SinTableMax;
+        T val = sinTable.table[id];
+        return (isLatter != (radian < 0)) ? -val : val;
+    }
+
 
-    struct AsinTable
+    // 周の切り捨てを実数で行うので、radianが大きくても周期がずれない
+    template<typename T>
+    static T sinLerpOf(const KotsubuMathTable::SinArray<T>& sinTable, T radian)
     {
-        static constexpr int Resolution  = 3000;
-        static constexpr int TableMax    = Resolution;
-        double table[TableMax];
-    } Asin;
+        T   absRad  = std::abs(radian);
+        T   halfQty = std::floor(absRad * static_cast<T>(One / Pi));  // πがいくつ分あるか
+        T   scaled  = (absRad - halfQty * static_cast<T>(Pi)) * KotsubuMathTable::SinResolution;
+        int id      = static_cast<int>(scaled);
+        T   rate    = scaled - id;
+
+        bool isLatter = (static_cast<long long>(halfQty) & 1);
+        T val = sinTable.table[id] + (sinTable.table[id + 1] - sinTable.table[id]) * rate;
+        return (isLatter != (radian < 0)) ? -val : val;
+    }
 
 
+    template<typename T>
+    static T asinOf(const KotsubuMathTable::AsinArray<T>& asinTable, T ratio)
+    {
+        int id = std::abs(static_cast<int>(ratio * ratio * KotsubuMathTable::AsinTableMax + static_cast<T>(RoundFix)));
+        if (id >= KotsubuMathTable::AsinTableMax) id = KotsubuMathTable::AsinTableMax - 1;
 
-    // 【隠しメソッド】
-    // 隠しコンストラクタ
-    KotsubuMath()
+        return (ratio < 0) ? -asinTable.table[id] : asinTable.table[id];
+    }
+
+
+    template<typename T>
+    static T asinLerpOf(const KotsubuMathTable::AsinArray<T>& asinTable, T ratio)
     {
-        // sinテーブルを作成（cos兼用）
-        double n;
-        for (int i = 0; i < Sin.TableMax; ++i) {
-            n = std::sin(static_cast<double>(i) / Sin.Resolution);
-            Sin.table[i] = (n < Epsilon) ? 0.0 : n;
-        }
-        
-        // asinテーブルを作成（acos兼用）
-        double max = Asin.TableMax - 1;
-        for (int i = 0; i < Asin.TableMax; ++i) {
-            n = std::asin(sqrt(i / max));
-            Asin.table[i] = (n < Epsilon) ? 0.0 : n;
-        }
+        T scaled = ratio * ratio * (KotsubuMathTable::AsinTableMax - 1);
+        if (scaled >= KotsubuMathTable::AsinTableMax - 1) return (ratio < 0) ? static_cast<T>(-RightAngle) : static_cast<T>(RightAngle);
+
+        int id   = static_cast<int>(scaled);
+        T   rate = scaled - id;
+        T   val  = asinTable.table[id] + (asinTable.table[id + 1] - asinTable.table[id]) * rate;
+        return (ratio < 0) ? -val : val;
     }
 
+
+
+    // 【隠しメソッド】
+    // 隠しコンストラクタ（テーブルはコンパイル時に作成済み）
+    KotsubuMath()
+    {}
+
     ~KotsubuMath(){}                             // 隠しデストラクタ
     KotsubuMath(const KotsubuMath&);             // 隠しコピーコンストラクタ
     KotsubuMath& operator=(const KotsubuMath&);  // 隠しコピー代入演算子
@@ -1,1377 +1,4595 @@
-﻿#pragma once
-#include <cmath>
-#include <vector>
-#include <algorithm>
-#include <Siv3D.hpp>
-#include "kotsubu_math.h"
-
-
-
-namespace KotsubuParticle
-{
-    /////////////////////////////////////////////////////////////////////////////////////
-    // 【基底クラス】すべてのパーティクルの元となるクラス。単独利用不可
-    //
-    class Works
-    {
-    protected:
-        KotsubuMath& math = KotsubuMath::getInstance();
-        // 【テスト】
-        Font font = Font(24);
-        Stopwatch timer;
-
-        // 【内部定数】
-        static inline const double Pi = 3.141592653589793;
-        static inline const double TwoPi = Pi * 2.0;            // Radianの最大値
-        static inline const double Deg2Rad = Pi / 180.0;        // Degに掛けるとRad
-        static inline const double Rad2Deg = 180.0 / Pi;        // Radに掛けるとDeg
-        static inline const double RootTwo = 1.414213562373095; // 斜辺が45°の直角三角形における、斜辺の比（他の辺は共に1）
-        static inline const double One  = 1.0;                  // 1.0
-        static inline const double Half = 0.5;                  // 0.5
-        static inline const double FrameSecOf60Fps  = 1.0 / 60; // 60FPSのときの1フレームの秒数
-        static inline const double ReflectionPowerRate = 0.8;
-        static inline const double FadeoutLimit        = 0.01;
-        static inline const double WorldMargin         = 30.0;
-
-
-
-        // 【内部構造体】粒子パラメータ、全体パラメータ
-        struct Element
-        {
-            Vec2   pos;
-            Vec2   oldPos;
-            double radian;
-            double speed;
-            ColorF color;
-            double gravity;
-            double liveTime;
-            bool   fadeout;
-            bool   enable;
-            Element() :
-                pos(Vec2(0, 0)), radian(0.0), speed(5.0),
-                color(ColorF(1.0, 0.9, 0.6, 0.8)), gravity(0.0),
-                liveTime(0.0), fadeout(false), enable(true)
-            {}
-            Element(Vec2 _pos, double _radian, double _speed, ColorF _color) :
-                pos(_pos), radian(_radian), speed(_speed), color(_color), gravity(0.0),
-                liveTime(0.0), fadeout(false), enable(true)
-            {}
-        };
-
-
-        struct Property
-        {
-            double     randPow;
-            double     radianRange;
-            double     accelSpeed;
-            ColorF     accelColor;
-            double     gravityPower;
-            double     gravityRad;
-            double     fadeoutTime;
-            double     fadeoutRate;
-            BlendState blendState;
-            Property() :
-                randPow(3.0), radianRange(TwoPi),
-                accelSpeed(-0.1), accelColor(-0.01, -0.02, -0.03, -0.001),
-                gravityPower(0.2), gravityRad(Pi / 2.0), 
-                fadeoutTime(1.0), fadeoutRate(0.975),
-                blendState(s3d::BlendState::Additive)
-            {}
-        };
-
-
-
-        // 【内部フィールド】衝突判定用
-        std::vector<KotsubuMath::Line>   obstacleLines;
-        std::vector<KotsubuMath::Rect>   obstacleRects;
-        std::vector<KotsubuMath::Circle> obstacleCircles;
-        std::vector<std::vector<Vec2>>   obstaclePolygons;
-        std::vector<std::vector<Vec2>>   obstaclePolylines;
-
-
-
-        // 【隠しコンストラクタ】
-        Works()
-        {}
-
-
-        // 【内部メソッド】
-        double fixSize(double size)
-        {
-            if (size < 1.0)size = 1.0;
-            return size;
-        }
-
-
-        double fixSpeed(double speed)
-        {
-            if (speed < 0.0)speed = 0.0;
-            return speed;
-        }
-
-
-        double fixGravityPower(double power)
-        {
-            if (power < 0.0) power = 0.0;
-            return power;
-        }
-
-
-        double fixRandomPower(double power)
-        {
-            if (power < 0.0)power = 0.0;
-            return power;
-        }
-
-
-        //// 【内部メソッド】無効な粒子を削除（Erase-Removeイディオム）
-        //template<typename T>
-        //void cleanElements(T& elements)
-        //{
-        //    // いらない物を後ろにどける
-        //    auto dustIt = std::remove_if(elements.begin(), elements.end(),
-        //        [](Element& elm) { return !elm.enable; });
-
-        //    // どけた部分を抹消
-        //    elements.erase(dustIt, elements.end());
-        //}
-
-
-        // 【内部メソッド】無効な粒子を削除（軽量版。並びの安定性なし）
-        template<typename T>
-        void cleanElements(T& elements)
-        {
-            // 【テスト】
-            timer.restart();
-
-            int i = 0;
-
-            while (i < elements.size()) {
-                if (!elements[i].enable) {
-                    std::swap(elements[i], elements.back());  // 末尾と交換
-                    elements.pop_back();                      // 末尾を削除
-                }
-                else ++i;
-            }
-
-            // 【テスト】
-            timer.pause();
-            //font(U"elements.size    : ", elements.size()).draw(0, 30);
-            //font(U"elements.capacity: ", elements.capacity()).draw(0, 60);
-            //font(U"cleanElements time(ms): ", timer.ms()).draw(0, 90);
-        }
-
-
-        // 【内部メソッド】すべての障害物をスケーリング
-        void scalingObstacles(double scale)
-        {
-            if (scale == 1.0) return;  // 等倍なら帰る
-            double rate = math.inverseNumber(scale);
-
-            for (auto& r : obstacleLines) {
-                r.startPos *= rate;
-                r.endPos   *= rate;
-            }
-            for (auto& r : obstacleRects) {
-                r.left   *= rate;
-                r.top    *= rate;
-                r.right  *= rate;
-                r.bottom *= rate;
-            }
-            for (auto& r : obstacleCircles) {
-                r.pos    *= rate;
-                r.radius *= rate;
-            }
-            for (auto& polygon : obstaclePolygons) {
-                for (auto& vertex : polygon) {
-                    vertex.x *= rate;
-                    vertex.y *= rate;
-                }
-            }
-            for (auto& polyline : obstaclePolylines) {
-                for (auto& vertex : polyline) {
-                    vertex.x *= rate;
-                    vertex.y *= rate;
-                }
-            }
-        }
-
-
-        // 【内部メソッド】すべての衝突判定を行う（障害物は破棄）
-        template<typename T>
-        void collisionAll(T& elements, double deltaTimeSec)
-        {
-            double timeScale = FrameSecOf60Fps / deltaTimeSec;
-            // 【テスト】
-            timer.restart();
-
-            // すべての障害物に対する衝突判定
-            collisionLines(elements, timeScale);
-            collisionRects(elements, timeScale);
-            collisionCircles(elements, timeScale);
-            collisionPolygons(elements, timeScale);
-            collisionPolylines(elements, timeScale);
-                
-            // すべての障害物をクリア
-            obstacleLines.clear();
-            obstacleRects.clear();
-            obstacleCircles.clear();
-            obstaclePolygons.clear();
-            obstaclePolylines.clear();
-            
-            // 【テスト】
-            timer.pause();
-            //font(U"collisionAll time(ms): ", timer.ms()).draw(0, 120);
-        }
-
-
-        // 【内部メソッド】線分との衝突判定
-        template<typename T>
-        void collisionLines(T& elements, double timeScale)
-        {
-            if (obstacleLines.empty()) return;
-            std::rotate(obstacleLines.begin(), obstacleLines.begin() + Random(obstacleLines.size() - 1), obstacleLines.end());
-
-            for (auto& elm : elements) {
-                for (auto& line : obstacleLines) {
-                    if (math.hit.lineOnLine(line.startPos, line.endPos, elm.oldPos, elm.pos)) {
-                        double rad = math.direction(line.endPos - line.startPos);
-                        reverseDirection(elm, rad, timeScale);
-                        elm.pos = elm.oldPos;
-                        elm.fadeout = true;
-                        break;
-                    }
-                }
-            }
-        }
-
-
-        // 【内部メソッド】矩形との衝突判定
-        template<typename T>
-        void collisionRects(T& elements, double timeScale)
-        {
-            if (obstacleRects.empty()) return;
-            std::rotate(obstacleRects.begin(), obstacleRects.begin() + Random(obstacleRects.size() - 1), obstacleRects.end());
-
-            for (auto& elm : elements) {
-                for (auto& rect : obstacleRects) {
-                    if (math.hit.pointOnBox(elm.pos, rect)) {
-                        if (math.hit.lineOnHorizontal(elm.oldPos.y, elm.pos.y, rect.top) ||
-                            math.hit.lineOnHorizontal(elm.oldPos.y, elm.pos.y, rect.bottom)) {
-                            reverseDirection(elm, 0.0, timeScale);
-                        }
-                        else {
-                            reverseDirection(elm, math.RightAngle, timeScale);
-                        }
-                        elm.pos = elm.oldPos;
-                        elm.fadeout = true;
-                        break;
-                    }
-                }
-            }
-        }
-
-
-        // 【内部メソッド】円との衝突判定
-        template<typename T>
-        void collisionCircles(T& elements, double timeScale)
-        {
-            if (obstacleCircles.empty()) return;
-            std::rotate(obstacleCircles.begin(), obstacleCircles.begin() + Random(obstacleCircles.size() - 1), obstacleCircles.end());
-
-            for (auto& elm : elements) {
-                for (auto& circle : obstacleCircles) {
-                    double radiusPow = circle.radius * circle.radius;
-                    if (math.distancePow(elm.pos, circle.pos) < radiusPow) {
-                        reverseDirection(elm, math.direction(circle.pos - elm.pos) + math.RightAngle, timeScale);
-                        elm.pos = elm.oldPos;
-                        elm.fadeout = true;
-                        break;
-                    }
-                }
-            }
-        }
-
-
-        // 【内部メソッド】凸多角形（全ての内角は180°以下）との衝突判定
-        // 処理速度優先のため、細長い部分は「壁抜け」が発生する
-        // ＜引数＞ vertices
-        // ・多角形の各頂点の座標を、vector<Vec2>に「時計回り」の順に格納したもの
-        template<typename T>
-        void collisionPolygons(T& elements, double timeScale)
-        {
-            if (obstaclePolygons.empty()) return;
-            std::rotate(obstaclePolygons.begin(), obstaclePolygons.begin() + Random(obstaclePolygons.size() - 1), obstaclePolygons.end());
-
-            for (auto& elm : elements) {
-                for (auto& vertices : obstaclePolygons) {
-                    if (math.hit.pointOnPolygon(elm.pos, vertices)) {
-                        // どの辺と交差したかを調べて跳ね返す
-                        bool isIntersect = false;
-                        for (int i = 0, edgeQty = vertices.size() - 1; i < edgeQty; ++i) {
-                            KotsubuMath::Line edge(vertices[i], vertices[i + 1]);
-                            if (math.hit.lineOnLine(edge.startPos, edge.endPos, elm.oldPos, elm.pos)) {
-                                double rad = math.direction(edge.endPos - edge.startPos);
-                                reverseDirection(elm, rad, timeScale);
-                                elm.pos = elm.oldPos;
-                                elm.fadeout = true;
-                                isIntersect = true;
-                                break;
-                            }
-                        }
-                        // 交差している辺が無い（図形の内部）なら、図形の外に出ない限り
-                        // 上の処理が行われ続けて重くなるので、粒子を消す
-                        elm.enable = isIntersect;
-                        break;
-                    }
-                }
-            }
-        }
-
-
-        // 【内部メソッド】ポリライン（数珠繋ぎの線分）との衝突判定
-        template<typename T>
-        void collisionPolylines(T& elements, double timeScale)
-        {
-            if (obstaclePolylines.empty()) return;
-            std::rotate(obstaclePolylines.begin(), obstaclePolylines.begin() + Random(obstaclePolylines.size() - 1), obstaclePolylines.end());
-
-            for (auto& elm : elements) {
-                for (auto& vertices : obstaclePolylines) {
-                    bool isIntersect = false;
-                    for (int i = 0, edgeQty = vertices.size() - 1; i < edgeQty; ++i) {
-                        KotsubuMath::Line edge(vertices[i], vertices[i + 1]);
-                        if (math.hit.lineOnLine(edge.startPos, edge.endPos, elm.oldPos, elm.pos)) {
-                            double rad = math.direction(edge.endPos - edge.startPos);
-                            reverseDirection(elm, rad, timeScale);
-                            elm.pos = elm.oldPos;
-                            elm.fadeout = true;
-                            isIntersect = true;
-                            break;
-                        }
-                    }
-                    if (isIntersect) break;
-                }
-            }
-        }
-
-
-        // 【内部メソッド】粒子の進行方向を反転（位置修正なし）
-        // ＜引数＞
-        // reflectionAxisRad --- 反射軸の角度
-        void reverseDirection(Element& element, double reflectionAxisRad, double timeScale)
-        {
-            Vec2 move = element.pos - element.oldPos;
-            
-            // 進行方向を反転
-            // このプログラムの移動処理は、element.radianとgravityRadの
-            // 「2系統」を合算して、実際の「見た目の方向」となる。
-            // よって、「見た目の方向」を反射させるためには、1系統だけを反射
-            // しても意味はなく、「実際に移動した量、および角度」を元に算出する。
-            element.radian = math.reflection(math.direction(move), reflectionAxisRad);
-
-            // 速度を「移動距離」とし、力を減衰させる。（直前までの引力成分も含まれる）
-            element.speed = math.length(move) * timeScale * ReflectionPowerRate;
-
-            // 引力をリセット（引力成分はelement.speedに引き継がれている）
-            element.gravity = 0.0;
-        }
-
-
-        //// 【内部メソッド】衝突面を通り過ぎた粒子位置を修正（厳密。負荷高め）
-        //// ＜引数＞
-        //// lineStartPos --- 衝突面（線分）の始点
-        //// lineNormal   --- 衝突面（線分）の正規化ベクトル
-        //void fixCollisionOverrun(Element& element, Vec2 lineStartPos, Vec2 lineNormal)
-        //{
-        //    Vec2 normal = math.normalize(element.pos - element.oldPos);
-        //    Vec2 hypot  = element.pos - lineStartPos;
-        //    double len  = abs(math.outerProduct(hypot, lineNormal));
-
-        //    element.pos -= normal * len * 2.0;
-        //}
-
-
-        //// 【内部メソッド】衝突面を通り過ぎた粒子位置を修正（軽量版）
-        //// 次の移動時に衝突ループさせない最低限の修正のため、潜り込みは発生する。
-        //// もっと軽量、かつ潜り込まないようにするには、単純に pos = oldPos とすればよい
-        //void fixCollisionOverrunLite(Element& element)
-        //{
-        //    Vec2 v(element.pos - element.oldPos);
-        //    element.pos = element.oldPos + v * ReflectionPowerRate;
-        //}
-
-
-
-    public:
-        // 【メソッド】衝突判定の図形を登録（線分）
-        // 順次登録可能。次回update時に反映＆すべて破棄
-        void registObstacleLine(Vec2 lineStartPos, Vec2 lineEndPos)
-        {
-            obstacleLines.emplace_back(KotsubuMath::Line(lineStartPos, lineEndPos));
-        }
-
-
-        // 【メソッド】衝突判定の図形を登録（矩形）
-        // 順次登録可能。次回update時に反映＆すべて破棄
-        void registObstacleRect(double left, double top, double right, double bottom)
-        {
-            obstacleRects.emplace_back(KotsubuMath::Rect(left, top, right, bottom));
-        }
-
-
-        // 【メソッド】衝突判定の図形を登録（円）
-        // 順次登録可能。次回update時に反映＆すべて破棄
-        void registObstacleCircle(Vec2 pos, double radius)
-        {
-            obstacleCircles.emplace_back(KotsubuMath::Circle(pos, radius));
-        }
-
-
-        // 【メソッド】衝突判定の図形を登録（凸多角形。全ての内角は180°以下）
-        // 順次登録可能。次回update時に反映＆すべて破棄。
-        // 処理速度優先のため、細長い部分は「壁抜け」が発生する。問題がある場合は、
-        // 図形をそこだけ「線分」で構成するとよい（registObstacleLineは正確）
-        // ＜引数＞ vertices
-        // ・各頂点の座標を、vector<Vec2>に「時計回り」の順に格納したもの
-        // ・凹型にならないよう注意する（動作不定。どうしても凹型にしたい場合は、凸型に分けて複数登録する）
-        // ・最後の頂点と最初の頂点は自動的に閉じられる
-        void registObstaclePolygon(const std::vector<Vec2>& vertices)
-        {
-            if (vertices.size() < 3) return;  // 頂点が3個未満なら登録しない
-            obstaclePolygons.emplace_back(vertices);
-            obstaclePolygons.back().emplace_back(vertices[0]);  // 図形を閉じるために「最初の頂点」を追加
-        }
-
-
-        // 【メソッド】衝突判定の図形を登録（ポリライン。数珠繋ぎの線分）
-        // 順次登録可能。次回update時に反映＆すべて破棄。
-        // ＜引数＞ vertices
-        // ・各頂点の座標を、順番にvector<Vec2>に格納したもの
-        void registObstaclePolyline(const std::vector<Vec2>& vertices)
-        {
-            if (vertices.size() < 2) return;  // 頂点が2個未満なら登録しない
-            obstaclePolylines.emplace_back(vertices);
-        }
-    };
-
-
-
-
-
-    /////////////////////////////////////////////////////////////////////////////////////
-    // 【メインクラス】円形のパーティクル
-    // 円系パーティクルの元となるクラス。他の円系パーティクルはこれを拡張（継承）したもの
-    //
-    class Circle : public Works
-    {
-    protected:
-        // クラス内部で使用する構造体
-        struct CircleElement : public Element
-        {
-            double size;
-            CircleElement() : size(20.0)
-            {}
-            CircleElement(Vec2 _pos, double _size, double _radian, double _speed, ColorF _color) :
-                Element(_pos, _radian, _speed, _color), size(_size)
-            {}
-        };
-
-
-        struct CircleProperty : public Property, public CircleElement
-        {
-            double  accelSize;
-            CircleProperty() : accelSize(-0.01)
-            {}
-        };
-
-
-        // 【フィールド】
-        CircleProperty property;
-        std::vector<CircleElement> elements;
-
-
-
-    public:
-        // 【コンストラクタ】
-        Circle(size_t reserve = 3000)
-        {
-            elements.reserve(reserve);
-        }
-
-
-        // 【セッタ】各初期パラメータ。メソッドチェーン方式
-        Circle& pos(         Vec2   pos)    { property.pos          = pos;                        return *this; }
-        Circle& size(        double size)   { property.size         = fixSize(size);              return *this; }
-        Circle& speed(       double speed)  { property.speed        = fixSpeed(speed);            return *this; }
-        Circle& color(       ColorF color)  { property.color        = color;                      return *this; }
-        Circle& angle(       double degree) { property.radian       = math.toRadian(degree);      return *this; }
-        Circle& angleRange(  double degree) { property.radianRange  = math.toRadianRange(degree); return *this; }
-        Circle& accelSize(   double size)   { property.accelSize    = size;                       return *this; }
-        Circle& accelSpeed(  double speed)  { property.accelSpeed   = speed;                      return *this; }
-        Circle& accelColor(  ColorF color)  { property.accelColor   = color;                      return *this; }
-        Circle& gravity(     double power)  { property.gravityPower = fixGravityPower(power);     return *this; }
-        Circle& gravityAngle(double degree) { property.gravityRad   = math.toRadian(degree);      return *this; }
-        Circle& random(      double power)  { property.randPow      = fixRandomPower(power);      return *this; }
-        Circle& blendState(s3d::BlendState state) { property.blendState = state; return *this; }
-
-
-        // 【メソッド】生成
-        void create(int quantity)
-        {
-            double sizeRandRange  = property.size * property.randPow * 0.03;
-            double radShake       = (property.radianRange * property.randPow + property.randPow) * 0.05;
-            double radRangeHalf   = property.radianRange * Half;
-            double speedRandLower = -property.randPow * Half;
-
-            for (int i = 0; i < quantity; ++i) {
-                // サイズ
-                double size = property.size + Random(-sizeRandRange, sizeRandRange);
-
-                // 角度
-                double shake = Random(-radShake, radShake) * Random(One) * Random(One);
-                double range = Random(-radRangeHalf, radRangeHalf);
-                double rad   = fmod(property.radian + range + shake + TwoPi, TwoPi);
-
-                // スピード
-                double speed = property.speed + Random(speedRandLower, property.randPow);
-
-                // 要素を追加
-                elements.emplace_back(CircleElement(property.pos, size, rad, speed, property.color));
-            }
-        }
-
-
-        // 【メソッド】アップデート
-        void update()
-        {
-            double delta        = s3d::System::DeltaTime();
-            double timeScale    = delta / FrameSecOf60Fps;
-            double windowWidth  = s3d::Window::Width();
-            double windowHeight = s3d::Window::Height();
-            double gravitySin   = sin(property.gravityRad) * timeScale;
-            double gravityCos   = cos(property.gravityRad) * timeScale;
-            double accelAlphaFixed   = property.accelColor.a * timeScale;
-            ColorF accelRgbFixed     = property.accelColor * timeScale;  // ColorF型の演算は、アルファは対象外
-            double accelSizeFixed    = property.accelSize * timeScale;
-            double gravityPowerFixed = property.gravityPower * timeScale;
-            double accelSpeedFixed   = property.accelSpeed * timeScale;
-
-            for (auto& r : elements) {
-                if (r.fadeout) {
-                    // フェードアウト
-                    r.color.a *= property.fadeoutRate;
-                    if (r.color.a < FadeoutLimit) {
-                        r.enable = false;
-                        continue;
-                    }
-                }
-                else {
-                    // アルファの変化
-                    r.color.a += accelAlphaFixed;
-                    if (r.color.a < 0.0 && property.accelColor.a < 0.0) {
-                        r.enable = false;
-                        continue;
-                    }
-                    // 生存時間を累積
-                    r.liveTime += delta;
-                    if (r.liveTime > property.fadeoutTime)
-                        r.fadeout = true;
-                }
-
-                // RGBの変化
-                r.color += accelRgbFixed;
-
-                // サイズの変化
-                r.size += accelSizeFixed;
-                if (r.size < 0.0) {
-                    r.enable = false;
-                    continue;
-                }
-
-                // 移動
-                r.oldPos = r.pos;
-                r.pos.x += cos(r.radian) * r.speed * timeScale;
-                r.pos.y += sin(r.radian) * r.speed * timeScale;
-
-                // 引力
-                r.gravity += gravityPowerFixed;
-                r.pos.x += gravityCos * r.gravity;
-                r.pos.y += gravitySin * r.gravity;
-
-                // 領域外の判定
-                double margin = r.size + WorldMargin;
-                if ((r.pos.x < -margin) || (r.pos.x > windowWidth  + margin) ||
-                    (r.pos.y < -margin) || (r.pos.y > windowHeight + margin)) {
-                    r.enable = false;
-                    continue;
-                }
-
-                // スピードの変化
-                r.speed += accelSpeedFixed;
-                if (r.speed < 0.0) r.speed = 0.0;
-            }
-
-            // 衝突判定
-            collisionAll(elements, delta);
-
-            // 無効な粒子を削除
-            cleanElements(elements);
-        }
-
-
-        // 【メソッド】ドロー
-        void draw()
-        {
-            s3d::RenderStateBlock2D tmp(property.blendState);  // tmpが生きている間だけ有効。破棄時に元に戻る
-
-            for (auto& r : elements)
-                s3d::Circle(r.pos, r.size).draw(r.color);
-        }
-    };
-
-
-
-
-
-    /////////////////////////////////////////////////////////////////////////////////////
-    // 【Circleを継承】淡い光のパーティクル（なめらかだが重い）
-    //
-    class CircleLight : public Circle
-    {
-    public:
-        // 【メソッド】ドロー（オーバーライド）
-        void draw()
-        {
-            s3d::RenderStateBlock2D tmp(property.blendState);
-
-            for (auto& r : elements)
-                s3d::Circle(r.pos, r.size).drawShadow(Vec2(0, 0), 10.0, 2.0, r.color);
-        }
-    };
-
-
-
-
-
-    /////////////////////////////////////////////////////////////////////////////////////
-    // 【Circleを継承】煙のパーティクル
-    //
-    class CircleSmoke : public Circle
-    {
-    private:
-        // 【追加フィールド】
-        int layerQty;
-
-    public:
-        // 【コンストラクタ】
-        CircleSmoke() : layerQty(5)
-        {}
-
-        // 【セッタ】初期パラメータ。メソッドチェーン方式
-        CircleSmoke& layerQuantity(int qty)
-        { 
-            if (qty < 1)  qty = 1;
-            if (qty > 10) qty = 10;
-            layerQty = qty;
-            return *this;
-        }
-
-        // 【メソッド】ドロー（オーバーライド）
-        void draw()
-        {
-            s3d::RenderStateBlock2D tmp(property.blendState);
-
-            for (int i = 0; i < layerQty; ++i) {
-                double rate = One - i / static_cast<double>(layerQty);
-                for (auto& r : elements)
-                    s3d::Circle(r.pos, r.size * rate).draw(r.color);
-            }
-        }
-    };
-
-
-
-
-
-    /////////////////////////////////////////////////////////////////////////////////////
-    // 【メインクラス】点のパーティクル
-    // 点系パーティクルの元となるクラス。他の点系パーティクルはこれを拡張（継承）したもの。
-    // 最も多くのパーティクルを描画できる。ただし、このクラスはパーティクル数が
-    // 「0」でも画面全体のイメージを複製＆描画するため、最低負荷は高め。
-    // dotScaleメソッドでドットの拡大率が指定でき、粗いほど負荷を低減できる（1.0 ～ 8.0倍まで）
-    // ※この仕組みは、図形の描画が重く、ブレンディングも効かないため「点系」のみ
-    //
-    class Dot : public Works
-    {
-    protected:
-        // クラス内部で使用する構造体
-        struct DotProperty : public Property, public Element
-        {
-            double         dotScale;
-            SamplerState   samplerState;
-            DynamicTexture tex;
-            Image          img;
-            Image          blankImg;
-            DotProperty() : samplerState(s3d::SamplerState::ClampNearest)
-            {}
-        };
-
-
-        // 【フィールド】
-        DotProperty property;
-
-
-
-    public:
-        // 【フィールド】
-        std::vector<Element> elements;
-
-
-        // 【コンストラクタ】
-        Dot(size_t reserve = 10000)
-        {
-            elements.reserve(reserve);
-            dotScale(3.0);
-        }
-
-
-        // 【セッタ】各初期パラメータ。メソッドチェーン方式
-        Dot& pos(         Vec2   pos)    { property.pos          = pos;                        return *this; }
-        Dot& speed(       double speed)  { property.speed        = fixSpeed(speed);            return *this; }
-        Dot& color(       ColorF color)  { property.color        = color;                      return *this; }
-        Dot& angle(       double degree) { property.radian       = math.toRadian(degree);      return *this; }
-        Dot& angleRange(  double degree) { property.radianRange  = math.toRadianRange(degree); return *this; }
-        Dot& accelSpeed(  double speed)  { property.accelSpeed   = speed;                      return *this; }
-        Dot& accelColor(  ColorF color)  { property.accelColor   = color;                      return *this; }
-        Dot& gravity(     double power)  { property.gravityPower = fixGravityPower(power);     return *this; }
-        Dot& gravityAngle(double degree) { property.gravityRad   = math.toRadian(degree);      return *this; }
-        Dot& random(      double power)  { property.randPow      = fixRandomPower(power);      return *this; }
-        Dot& blendState(s3d::BlendState state) { property.blendState = state; return *this; }
-
-        // スムージング
-        Dot& smoothing(bool isSmooth)
-        {
-            property.samplerState = isSmooth ? s3d::SamplerState::ClampLinear :
-                                               s3d::SamplerState::ClampNearest;
-            return *this;
-        }
-
-        // ドットの拡大率。1.0（等倍） ～ 8.0
-        Dot& dotScale(double scale)
-        {
-            static double oldScale = -1;
-            if (scale < 1.0) scale = 1.0;
-            if (scale > 8.0) scale = 8.0;
-
-
-            if (scale != oldScale) {
-                property.dotScale = scale;
-
-                // 新しいサイズのブランクイメージを作る
-                double rate = math.inverseNumber(scale);
-                double margin = WorldMargin * 2.0 * rate;
-                property.blankImg = s3d::Image(static_cast<size_t>(Window::Width() * rate + margin),
-                                               static_cast<size_t>(Window::Height() * rate + margin));
-
-                // 動的テクスチャは「同じサイズ」のイメージを供給しないと描画されないためリセット。
-                // また、テクスチャやイメージのreleaseやclearは、連続で呼び出すとエラーする
-                property.tex.release();
-
-                oldScale = scale;
-            }
-
-            return *this;
-        }
-
-
-        // 【メソッド】生成
-        void create(int quantity)
-        {
-            double radShake       = (property.radianRange * property.randPow + property.randPow) * 0.05;
-            double radRangeHalf   = property.radianRange * Half;
-            double speedRandLower = -property.randPow * Half;
-            double margin         = WorldMargin / property.dotScale;
-            Vec2   pos            = property.pos * math.inverseNumber(property.dotScale);
-
-            if ((pos.x < -margin) || (pos.x >= property.blankImg.width() - margin) ||
-                (pos.y < -margin) || (pos.y >= property.blankImg.height() - margin))
-                return;
-
-            for (int i = 0; i < quantity; ++i) {
-                // 角度
-                double shake = Random(-radShake, radShake) * Random(One) * Random(One);
-                double range = Random(-radRangeHalf, radRangeHalf);
-                double rad = fmod(property.radian + range + shake + TwoPi, TwoPi);
-
-                // スピード
-                double speed = property.speed + Random(speedRandLower, property.randPow);
-
-                // 要素を追加
-                elements.emplace_back(Element(pos, rad, speed, property.color));
-            }
-        }
-
-
-        // 【メソッド】アップデート
-        void update()
-        {
-            double delta       = s3d::System::DeltaTime();
-            double timeScale   = delta / FrameSecOf60Fps;
-            double margin      = WorldMargin / property.dotScale;
-            double worldRight  = property.blankImg.width() - margin;
-            double worldBottom = property.blankImg.height() - margin;
-            double gravitySin  = sin(property.gravityRad) * timeScale;
-            double gravityCos  = cos(property.gravityRad) * timeScale;
-            double accelAlphaFixed   = property.accelColor.a * timeScale;
-            ColorF accelRgbFixed     = property.accelColor * timeScale;  // ColorF型の演算は、アルファは対象外
-            double gravityPowerFixed = property.gravityPower * timeScale;
-            double accelSpeedFixed   = property.accelSpeed * timeScale;
- 
-            for (auto& r : elements) {
-                if (r.fadeout) {
-                    // フェードアウト
-                    r.color.a *= property.fadeoutRate;
-                    if (r.color.a < FadeoutLimit) {
-                        r.enable = false;
-                        continue;
-                    }
-                }
-                else {
-                    // アルファの変化
-                    r.color.a += accelAlphaFixed;
-                    if (r.color.a < 0.0 && property.accelColor.a < 0.0) {
-                        r.enable = false;
-                        continue;
-                    }
-                    // 生存時間を累積
-                    r.liveTime += delta;
-                    r.fadeout = (r.liveTime > property.fadeoutTime);
-                }
-
-                // RGBの変化
-                r.color += accelRgbFixed;
-
-                // 移動
-                r.oldPos = r.pos;
-                r.pos.x += cos(r.radian) * r.speed * timeScale;
-                r.pos.y += sin(r.radian) * r.speed * timeScale;
-
-                // 引力
-                r.gravity += gravityPowerFixed;
-                r.pos.x += gravityCos * r.gravity;
-                r.pos.y += gravitySin * r.gravity;
-
-                // 領域外の判定（posはイメージ配列の添え字になるので慎重に）
-                if ((r.pos.x < -margin) || (r.pos.x >= worldRight) ||
-                    (r.pos.y < -margin) || (r.pos.y >= worldBottom)) {
-                    r.enable = false;
-                    continue;
-                }
-
-                // スピードの変化
-                r.speed += accelSpeedFixed;
-                if (r.speed < 0.0) r.speed = 0.0;
-            }
-
-            // 衝突判定
-            scalingObstacles(property.dotScale);
-            collisionAll(elements, delta);
-
-            // 無効な粒子を削除
-            cleanElements(elements);
-        }
-
-
-        // 【メソッド】ドロー
-        void draw()
-        {
-            // イメージをクリア（clear関数もあるが連続で呼び出すとエラーする）
-            property.img = property.blankImg;
-
-            // 余白をスケーリング
-            double margin = WorldMargin / property.dotScale;
-            Vec2 adjustPos = { margin, margin };
-
-            // イメージを作成（粒子の数だけ処理。posが確実にimg[n]の範囲内であること）
-            for (auto& r : elements)
-                property.img[(r.pos + adjustPos).asPoint()].set(r.color);
-
-            // 動的テクスチャを更新
-            property.tex.fill(property.img);
-
-            // 動的テクスチャをドロー
-            s3d::RenderStateBlock2D tmp(property.blendState, property.samplerState);
-            property.tex.scaled(property.dotScale).draw(-WorldMargin, -WorldMargin);
-        }
-    };
-
-
-
-
-
-    /////////////////////////////////////////////////////////////////////////////////////
-    // 【Dotを継承】点のパーティクル（加算合成）
-    //
-    class DotBlended : public Dot
-    {
-    public:
-        // 【メソッド】ドロー（オーバーライド）
-        void draw()
-        {
-            // イメージをクリア（clear関数もあるが連続で呼び出すとエラーする）
-            property.img = property.blankImg;
-
-            // 余白をスケーリング
-            double margin = WorldMargin / property.dotScale;
-            Vec2 adjustPos = { margin, margin };
-
-            // イメージを作成（粒子の数だけ処理。posが確実にimg[n]の範囲内であること）
-            for (auto& r : elements) {
-                // 現在位置の「余白の-margin分」を補正して添え字化
-                Point point = (r.pos + adjustPos).asPoint();
-
-                // 現在位置の色を求める（自前の加算ブレンディング）
-                ColorF src = property.img[point];
-                ColorF dst = { src.r + r.color.r * r.color.a,
-                               src.g + r.color.g * r.color.a,
-                               src.b + r.color.b * r.color.a,
-                               src.a + r.color.a };  // 本来は違うかもしれないが見栄えがよい（キラキラする）
-
-                // 求めた色をセット
-                property.img[point].set(dst);
-            }
-
-            // 動的テクスチャを更新
-            property.tex.fill(property.img);
-
-            // 動的テクスチャをドロー
-            s3d::RenderStateBlock2D tmp(property.blendState, property.samplerState);
-            property.tex.scaled(property.dotScale).draw(-WorldMargin, -WorldMargin);
-        }
-    };
-
-
-
-
-
-    /////////////////////////////////////////////////////////////////////////////////////
-    // 【Dotを継承】点のパーティクル（しっぽ付き）
-    //
-    class DotTailed : public Dot
-    {
-    public:
-        // 【メソッド】ドロー（オーバーライド）
-        void draw()
-        {
-            // イメージをクリア（clear関数もあるが連続で呼び出すとエラーする）
-            property.img = property.blankImg;
-
-            // 余白をスケーリング
-            double margin = WorldMargin / property.dotScale;
-            Vec2 adjustPos = { margin, margin };
-
-            // 【テスト】
-            int lenMax = -1;
-
-            // イメージを作成（粒子の数だけ処理。posが確実にimg[n]の範囲内であること）
-            for (auto& r : elements) {
-                Vec2   normal = math.normalize(r.pos - r.oldPos);
-                int    len    = static_cast<int>(math.distance(r.pos, r.oldPos) * 0.99);
-                Vec2   pos    = r.pos + adjustPos;
-                double alpha  = r.color.a;
-
-                // 【テスト】
-                if (len > lenMax) lenMax = len;
-
-                for (int i = 0; i <= len; ++i) {
-                    // 書き込み位置を添え字化
-                    Point point = pos.asPoint();
-
-                    // 書き込み位置の色を求める（自前の加算ブレンディング）
-                    ColorF src = property.img[point];
-                    ColorF dst = { src.r + r.color.r * r.color.a,
-                                   src.g + r.color.g * r.color.a,
-                                   src.b + r.color.b * r.color.a,
-                                   src.a + r.color.a };  // 本来は違うかもしれないが見栄えがよい（キラキラする）
-
-                    // 求めた色をセット
-                    property.img[point].set(dst);
-
-                    alpha *= 0.925;
-                    if (alpha < FadeoutLimit) break;
-                    pos -= normal;
-                }
-            }
-
-            // 【テスト】
-            font(U"lenMax: ", lenMax).draw();
-
-            // 動的テクスチャを更新
-            property.tex.fill(property.img);
-
-            // 動的テクスチャをドロー
-            s3d::RenderStateBlock2D tmp(property.blendState, property.samplerState);
-            property.tex.scaled(property.dotScale).draw(-WorldMargin, -WorldMargin);
-        }
-    };
-
-
-
-
-
-    /////////////////////////////////////////////////////////////////////////////////////
-    // 【メインクラス】星のパーティクル
-    // n角形やテクスチャパーティクルの元となるクラス
-    //
-    class Star : public Works
-    {
-    protected:
-        // クラス内部で使用する構造体
-        struct StarElement : public Element
-        {
-            double size;
-            double rotateRad;
-            double rotateSpeed;
-            StarElement() :
-                size(20.0), rotateSpeed(0.0)
-            {}
-            StarElement(Vec2 _pos, double _size, double _radian, double _speed, ColorF _color, double _rotateRad, double _rotateSpeed) :
-                Element(_pos, _radian, _speed, _color), size(_size), rotateRad(_rotateRad), rotateSpeed(_rotateSpeed)
-            {}
-        };
-
-
-        struct StarProperty : public Property, public StarElement
-        {
-            double accelSize;
-            StarProperty() : accelSize(1.3)
-            {
-                gravityPower = 0.0;
-            }
-        };
-
-
-        // 【フィールド】
-        StarProperty property;
-        std::vector<StarElement> elements;
-
-
-
-    public:
-        // 【コンストラクタ】
-        Star(size_t reserve = 2000)
-        {
-            elements.reserve(reserve);
-        }
-
-
-        // 【セッタ】各初期パラメータ。メソッドチェーン方式
-        Star& pos(         Vec2   pos)    { property.pos          = pos;                        return *this; }
-        Star& size(        double size)   { property.size         = fixSize(size);              return *this; }
-        Star& speed(       double speed)  { property.speed        = fixSpeed(speed);            return *this; }
-        Star& color(       ColorF color)  { property.color        = color;                      return *this; }
-        Star& angle(       double degree) { property.radian       = math.toRadian(degree);      return *this; }
-        Star& angleRange(  double degree) { property.radianRange  = math.toRadianRange(degree); return *this; }
-        Star& accelSize(   double size)   { property.accelSize    = size;                       return *this; }
-        Star& accelSpeed(  double speed)  { property.accelSpeed   = speed;                      return *this; }
-        Star& accelColor(  ColorF color)  { property.accelColor   = color;                      return *this; }
-        Star& gravity(     double power)  { property.gravityPower = fixGravityPower(power);     return *this; }
-        Star& gravityAngle(double degree) { property.gravityRad   = math.toRadian(degree);      return *this; }
-        Star& random(      double power)  { property.randPow      = fixRandomPower(power);      return *this; }
-        Star& rotate(      double speed)  { property.rotateSpeed  = speed;                      return *this; }
-        Star& blendState(s3d::BlendState state) { property.blendState = state; return *this; }
-
-        
-        // 【メソッド】生成
-        void create(int quantity)
-        {
-            double sizeRandRange    = property.size * property.randPow * 0.03;
-            double radShake         = (property.radianRange * property.randPow + property.randPow) * 0.05;
-            double radRangeHalf     = property.radianRange * Half;
-            double speedRandLower   = -property.randPow * Half;
-            double rotateSpeedRange = property.randPow * 0.002;
-
-            for (int i = 0; i < quantity; ++i) {
-                // サイズ
-                double size = property.size + Random(-sizeRandRange, sizeRandRange);
-
-                // 角度
-                double shake = Random(-radShake, radShake) * Random(One) * Random(One);
-                double range = Random(-radRangeHalf, radRangeHalf);
-                double rad   = fmod(property.radian + range + shake + TwoPi, TwoPi);
-
-                // スピード
-                double speed = property.speed + Random(speedRandLower, property.randPow);
-
-                // 回転
-                double rotateSpeed = property.rotateSpeed + Random(-rotateSpeedRange, rotateSpeedRange);
-
-                // 要素を追加
-                elements.emplace_back(StarElement(property.pos, size, rad, speed, property.color, Random(TwoPi), rotateSpeed));
-            }
-        }
-
-
-        // 【メソッド】アップデート
-        void update()
-        {
-            double delta        = s3d::System::DeltaTime();
-            double timeScale    = delta / FrameSecOf60Fps;
-            double windowWidth  = s3d::Window::Width();
-            double windowHeight = s3d::Window::Height();
-            double gravitySin   = sin(property.gravityRad) * timeScale;
-            double gravityCos   = cos(property.gravityRad) * timeScale;
-            double accelAlphaFixed   = property.accelColor.a * timeScale;
-            ColorF accelRgbFixed     = property.accelColor * timeScale;  // ColorF型の演算は、アルファは対象外
-            double accelSizeFixed    = property.accelSize * timeScale;
-            double gravityPowerFixed = property.gravityPower * timeScale;
-            double accelSpeedFixed   = property.accelSpeed * timeScale;
-            double rotateSpeedFixed  = property.rotateSpeed * timeScale;
-
-            for (auto& r : elements) {
-                if (r.fadeout) {
-                    // フェードアウト
-                    r.color.a *= property.fadeoutRate;
-                    if (r.color.a < FadeoutLimit) {
-                        r.enable = false;
-                        continue;
-                    }
-                }
-                else {
-                    // アルファの変化
-                    r.color.a += accelAlphaFixed;
-                    if (r.color.a < 0.0 && property.accelColor.a < 0.0) {
-                        r.enable = false;
-                        continue;
-                    }
-                    // 生存時間を累積
-                    r.liveTime += delta;
-                    r.fadeout = (r.liveTime > property.fadeoutTime);
-                }
-
-                // RGBの変化
-                r.color += accelRgbFixed;
-
-                // サイズの変化
-                r.size += accelSizeFixed;
-                if (r.size < 0.0) {
-                    r.enable = false;
-                    continue;
-                }
-
-                // 移動
-                r.oldPos = r.pos;
-                r.pos.x += cos(r.radian) * r.speed * timeScale;
-                r.pos.y += sin(r.radian) * r.speed * timeScale;
-
-                // 引力
-                r.gravity += gravityPowerFixed;
-                r.pos.x += gravityCos * r.gravity;
-                r.pos.y += gravitySin * r.gravity;
-
-                // 領域外の判定
-                double margin = r.size + WorldMargin;
-                if ((r.pos.x < -margin) || (r.pos.x > windowWidth  + margin) ||
-                    (r.pos.y < -margin) || (r.pos.y > windowHeight + margin)) {
-                    r.enable = false;
-                    continue;
-                }
-
-                // スピードの変化
-                r.speed += accelSpeedFixed;
-                if (r.speed < 0.0) r.speed = 0.0;
-
-                // 回転
-                r.rotateRad += rotateSpeedFixed;
-                if ((r.rotateRad < 0.0) || (r.rotateRad >= TwoPi))
-                    r.rotateRad = fmod(r.rotateRad, TwoPi);
-            }
-
-            // 衝突判定
-            collisionAll(elements, delta);
-
-            // 無効な粒子を削除
-            cleanElements(elements);
-        }
-
-
-        // 【メソッド】ドロー
-        void draw()
-        {
-            s3d::RenderStateBlock2D tmp(property.blendState);  // tmpが生きている間だけ有効。破棄時に元に戻る
-
-            for (auto& r : elements)
-                Shape2D::Star(r.size, r.pos, r.rotateRad).draw(r.color);
-        }
-    };
-
-
-
-
-
-    /////////////////////////////////////////////////////////////////////////////////////
-    // 【Starを継承】正方形のパーティクル
-    //
-    class Rect : public Star
-    {
-    public:
-        // 【メソッド】ドロー（オーバーライド）
-        // s3dにおけるCircleやStarのサイズは「半径 * 2」であるが、Rectのサイズは
-        //「左上を基点とした縦横の長さ」なので、基点が違う上、見かけの大きさは半分となる。
-        // これをCircleなどと処理を共通にするには、Rectが45°のときでも「想定する円」をはみ出ない
-        // ギリギリの大きさにする（想定する円に内接する正方形の大きさ）
-        void draw()
-        {
-            s3d::RenderStateBlock2D tmp(property.blendState);  // tmpが生きている間だけ有効。破棄時に元に戻る
-
-            for (auto& r : elements)
-                s3d::RectF(Arg::center = r.pos, r.size * RootTwo).rotated(r.rotateRad).draw(r.color);
-        }
-    };
-
-
-
-
-
-    /////////////////////////////////////////////////////////////////////////////////////
-    // 【Starを継承】五角形のパーティクル
-    //
-    class Pentagon : public Star
-    {
-    public:
-        // 【メソッド】ドロー（オーバーライド）
-        void draw()
-        {
-            s3d::RenderStateBlock2D tmp(property.blendState);  // tmpが生きている間だけ有効。破棄時に元に戻る
-            for (auto& r : elements)
-                Shape2D::Pentagon(r.size, r.pos, r.rotateRad).draw(r.color);
-        }
-    };
-
-
-
-
-
-    /////////////////////////////////////////////////////////////////////////////////////
-    // 【Starを継承】星のパーティクル（フェード）
-    //
-    class StarFade : public Star
-    {
-    protected:
-        // 【追加フィールド】
-        int layerQty;
-
-    public:
-        // 【コンストラクタ】
-        StarFade() : layerQty(5)
-        {}
-
-        // 【セッタ】初期パラメータ。メソッドチェーン方式
-        StarFade& layerQuantity(int qty)
-        { 
-            if (qty < 1)  qty = 1;
-            if (qty > 10) qty = 10;
-            layerQty = qty;
-            return *this;
-        }
-
-        // 【メソッド】ドロー（オーバーライド）
-        void draw()
-        {
-            s3d::RenderStateBlock2D tmp(property.blendState);
-
-            for (int i = 0; i < layerQty; ++i) {
-                double rate = One - i / static_cast<double>(layerQty) * Half;
-                for (auto& r : elements)
-                    Shape2D::Star(r.size * rate, r.pos, r.rotateRad).draw(r.color);
-            }
-        }
-    };
-
-
-
-
-
-    /////////////////////////////////////////////////////////////////////////////////////
-    // 【StarFadeを継承】正方形のパーティクル（フェード）
-    //
-    class RectFade : public StarFade
-    {
-    public:
-        // 【メソッド】ドロー（オーバーライド）
-        void draw()
-        {
-            s3d::RenderStateBlock2D tmp(property.blendState);
-
-            for (int i = 0; i < layerQty; ++i) {
-                double rate = One - i / static_cast<double>(layerQty) * Half;
-                for (auto& r : elements)
-                    s3d::RectF(Arg::center = r.pos, r.size * RootTwo * rate).rotated(r.rotateRad).draw(r.color);
-            }
-        }
-    };
-
-
-
-
-
-    /////////////////////////////////////////////////////////////////////////////////////
-    // 【StarFadeを継承】五角形のパーティクル（フェード）
-    //
-    class PentagonFade : public StarFade
-    {
-    public:
-        // 【メソッド】ドロー（オーバーライド）
-        void draw()
-        {
-            s3d::RenderStateBlock2D tmp(property.blendState);
-
-            for (int i = 0; i < layerQty; ++i) {
-                double rate = One - i / static_cast<double>(layerQty) * Half;
-                for (auto& r : elements)
-                    Shape2D::Pentagon(r.size * rate, r.pos, r.rotateRad).draw(r.color);
-            }
-        }
-    };
-
-
-
-
-
-    /////////////////////////////////////////////////////////////////////////////////////
-    // 【Starを継承】テクスチャのパーティクル
-    //
-    class Texture : public Star
-    {
-    protected:
-        // 【追加フィールド】
-        s3d::Texture tex = s3d::Texture(Emoji(U"🐈"), TextureDesc::Mipped);
-
-
-    public:
-        // 【コンストラクタ】
-        Texture()
-        {
-            property.color      = ColorF(1.0, 1.0, 1.0, 1.0);
-            property.accelColor = ColorF(0.0, 0.0, 0.0, -0.005);
-        }
-
-
-        // 【セッタ】描画するテクスチャーを登録
-        void setTexture(s3d::Texture& texture)
-        {
-            tex = texture;
-        }
-
-
-        // 【メソッド】ドロー（オーバーライド）
-        void draw()
-        {
-            s3d::RenderStateBlock2D tmp(property.blendState);  // tmpが生きている間だけ有効。破棄時に元に戻る
-            // テクスチャのサイズもRectと同じ仕様。基点を中心で描画するにはdrawAtメソッドを使う。
-            for (auto& r : elements)
-                tex.resized(r.size * RootTwo).rotated(r.rotateRad).drawAt(r.pos, r.color);
-        }
-    };
-}
+﻿#pragma once
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <type_traits>
+#include <cstdint>
+#include <thread>
+#include <limits>
+#include <array>
+#include <utility>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cstring>
+#include <Siv3D.hpp>
+#include "kotsubu_math.h"
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+    #define KOTSUBU_PARTICLE_SSE2
+    #include <emmintrin.h>  // サブピクセル描画（splatDot）をSSE2で行う
+#endif
+
+
+
+namespace KotsubuParticle
+{
+    // 【型】実数とベクトル。KotsubuMathと共通（USE_KOTSUBU_FLOATの定義でfloatとなる）
+    // 公開メソッドの引数はdoubleやVec2のままで、粒子の格納にのみ使用する
+    using Real     = KotsubuMath::Real;
+    using RealVec2 = KotsubuMath::Vec2;
+
+
+
+    /////////////////////////////////////////////////////////////////////////////////////
+    // 【構造体】単精度の色
+    // ColorFと相互に変換できる。ColorFと同じく、演算（+= と *）はアルファを対象外とする
+    //
+    struct ColorF32
+    {
+        float r, g, b, a;
+        ColorF32() : r(1.0f), g(1.0f), b(1.0f), a(1.0f)
+        {}
+        ColorF32(double _r, double _g, double _b, double _a) :
+            r(static_cast<float>(_r)), g(static_cast<float>(_g)), b(static_cast<float>(_b)), a(static_cast<float>(_a))
+        {}
+        ColorF32(const ColorF& color) :
+            ColorF32(color.r, color.g, color.b, color.a)
+        {}
+        operator ColorF() const { return ColorF(r, g, b, a); }
+        ColorF32& operator+=(const ColorF32& color) { r += color.r; g += color.g; b += color.b; return *this; }
+        ColorF32  operator* (float rate) const      { return ColorF32(r * rate, g * rate, b * rate, a); }
+    };
+
+#ifdef USE_KOTSUBU_FLOAT
+    using RealColor = ColorF32;
+#else
+    using RealColor = ColorF;
+#endif
+
+
+
+
+
+    /////////////////////////////////////////////////////////////////////////////////////
+    // 【列挙型】固定容量プールが満杯のときの動作
+    //
+    enum class Overflow
+    {
+        Reject,              // 新しい粒子を生成しない
+        KillOldest,          // 最も古い粒子を消して置きかえる
+        KillMostTransparent  // 最も透明な粒子を消して置きかえる
+    };
+
+
+
+    /////////////////////////////////////////////////////////////////////////////////////
+    // 【列挙型】サブエミッタを発動する条件
+    //
+    enum class SubEmit
+    {
+        Death,      // 粒子が消えたとき（寿命、領域外、多角形の内部など）
+        Collision,  // 粒子が障害物に当たったとき
+        Timer       // 粒子の生存時間が一定間隔を過ぎるたび
+    };
+
+
+
+    /////////////////////////////////////////////////////////////////////////////////////
+    // 【列挙型】障害物の種類
+    //
+    enum class ObstacleType
+    {
+        Line,      // registObstacleLine
+        Rect,      // registObstacleRect
+        Circle,    // registObstacleCircle
+        Polygon,   // registObstaclePolygon
+        Polyline   // registObstaclePolyline
+    };
+
+    constexpr size_t ObstacleTypeQty = 5;  // ObstacleTypeの数
+
+
+
+    /////////////////////////////////////////////////////////////////////////////////////
+    // 【構造体】衝突の記録（recordCollisionsで有効にし、collisionsで読む）
+    //
+    struct CollisionEvent
+    {
+        Vec2         pos;     // 当たった位置（面を越えた直後の粒子の位置。ウィンドウ座標）
+        Vec2         normal;  // 面の法線。粒子が来た側を向く（長さ1）
+        double       speed;   // 当たる直前の速さ（60FPSの1フレームあたりのピクセル）
+        ObstacleType type;    // 障害物の種類
+        uint32       id;      // 障害物の番号（種類ごとの、直前のupdateでの登録順）
+    };
+
+
+
+    /////////////////////////////////////////////////////////////////////////////////////
+    // 【構造体】連続した配列の読み取り専用の範囲（範囲for文で使える）
+    // 元の配列が変わる（次のupdate）までの間だけ有効
+    //
+    template<typename T>
+    struct ReadSpan
+    {
+        const T* first;
+        size_t   count;
+        const T* begin() const { return first; }
+        const T* end()   const { return first + count; }
+        size_t   size()  const { return count; }
+        bool     empty() const { return count == 0; }
+        const T& operator[](size_t i) const { return first[i]; }
+    };
+
+
+
+
+
+    /////////////////////////////////////////////////////////////////////////////////////
+    // 【列挙型】粒子の予算を使う優先度（Budget参照）
+    //
+    enum class BudgetPriority
+    {
+        Low,     // 上限の5割まで。処理が重いときは生成数と描画の手間を「品質の2乗」に減らす
+        Normal,  // 上限の8割まで。処理が重いときは生成数と描画の手間を「品質」に減らす
+        High     // 上限いっぱいまで。処理が重くても減らさない
+    };
+
+
+
+    /////////////////////////////////////////////////////////////////////////////////////
+    // 【クラス】粒子の予算（すべてのインスタンスで共通。シングルトン）
+    // すべてのインスタンスは生成時に登録され、生存粒子数の合計と、1フレームの生成数の合計を
+    // 上限以下に保つ。また、updateとdrawの計測時間が目標を超えると品質（0.0 ～ 1.0）を下げ、
+    // 優先度の低いインスタンスから生成数と描画の手間（層の数、しっぽの長さ）を減らす。
+    // 上限と目標はどれも0（既定）で無効。別スレッドのupdateから呼ばれても安全
+    //
+    class Budget
+    {
+    private:
+        // 【内部定数】
+        static constexpr double QualityRecovery = 0.05;  // 余裕のあるフレームごとに戻す品質
+        static constexpr double QualityMaxDrop  = 0.5;   // 1フレームで下げる品質の下限（半分まで）
+        static constexpr double RecoveryMargin  = 0.8;   // 目標のこの割合を下回ったら品質を戻す
+
+        // 【内部フィールド】
+        std::mutex            mutex;           // 生成数の割り当てとフレームの切りかえ用
+        std::atomic<size_t>   instanceQty;     // 登録中のインスタンス数
+        std::atomic<int64_t>  liveQty;         // 生存粒子数の合計（生成の予約を含む）
+        std::atomic<int64_t>  frameCostNs;     // 今回のフレームのupdateとdrawの計測時間（ナノ秒）
+        std::atomic<double>   qualityRate;     // 品質
+        size_t                maxLiveQty;      // 生存粒子数の上限
+        size_t                maxSpawnQty;     // 1フレームの生成数の上限
+        double                targetMs;        // updateとdrawの目標時間（ミリ秒）
+        double                minQualityRate;  // 品質の下限
+        size_t                spawnQty;        // 今回のフレームの生成数
+        std::atomic<double>   lastCostMs;      // 前回のフレームの計測時間（ミリ秒）
+        uint64                frame;           // 今回のフレーム番号
+
+        Budget() :
+            instanceQty(0), liveQty(0), frameCostNs(0), qualityRate(1.0),
+            maxLiveQty(0), maxSpawnQty(0), targetMs(0.0), minQualityRate(0.1),
+            spawnQty(0), lastCostMs(0.0), frame(0)
+        {}
+
+
+        // 【内部メソッド】フレームの切りかえ（mutexを取得してから呼ぶ）
+        // 前回のフレームの計測時間から品質を決め、生成数を0に戻す
+        void rollFrame()
+        {
+            lastCostMs = frameCostNs.exchange(0) / 1000000.0;
+            spawnQty   = 0;
+
+            double quality = qualityRate.load();
+            if (targetMs <= 0.0)
+                quality = 1.0;
+            else if (lastCostMs > targetMs)
+                quality *= std::max(QualityMaxDrop, targetMs / lastCostMs);
+            else if (lastCostMs < targetMs * RecoveryMargin)
+                quality += QualityRecovery;
+            qualityRate = std::clamp(quality, minQualityRate, 1.0);
+        }
+
+
+        // 【内部メソッド】フレーム番号が変わっていれば切りかえる（mutexを取得してから呼ぶ）
+        void followFrame()
+        {
+            uint64 now = s3d::System::FrameCount();
+            if (now != frame) {
+                frame = now;
+                rollFrame();
+            }
+        }
+
+
+        // 【内部メソッド】計測の開始時に、フレーム番号が変わっていれば切りかえる
+        // 生成の無いフレームでも、計測時間と品質は1フレームごとに更新される
+        void enterFrame()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            followFrame();
+        }
+
+
+        // 【内部メソッド】優先度ごとの、上限のうち使える割合
+        static double headroomOf(BudgetPriority priority)
+        {
+            switch (priority) {
+            case BudgetPriority::Low:    return 0.5;
+            case BudgetPriority::Normal: return 0.8;
+            default:                     return 1.0;
+            }
+        }
+
+
+    public:
+        // 【構造体】計測。生きている間の時間を、今回のフレームの計測時間に加える
+        // 開始時にフレームを切りかえるので、前のフレームの計測時間が持ち越されない
+        struct Meter
+        {
+            std::chrono::steady_clock::time_point start;
+            Meter()
+            {
+                getInstance().enterFrame();
+                start = std::chrono::steady_clock::now();
+            }
+            ~Meter()
+            {
+                auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+                getInstance().frameCostNs += static_cast<int64_t>(ns.count());
+            }
+        };
+
+
+        // 【構造体】インスタンスの登録証。Worksが1つずつ持ち、生存粒子数の持ち分を記録する
+        // 複製するとインスタンスと粒子が増えるので、持ち分も増やす
+        struct Ticket
+        {
+            size_t         live;      // 生存粒子数の持ち分（生成の予約を含む）
+            BudgetPriority priority;  // 優先度
+            double         carry;     // 生成数を減らしたときの端数（次の生成に持ち越す）
+            Ticket() : live(0), priority(BudgetPriority::Normal), carry(0.0)
+            {
+                ++getInstance().instanceQty;
+            }
+            Ticket(const Ticket& other) : live(other.live), priority(other.priority), carry(0.0)
+            {
+                ++getInstance().instanceQty;
+                getInstance().liveQty += static_cast<int64_t>(live);
+            }
+            Ticket& operator=(const Ticket&) = delete;
+            ~Ticket()
+            {
+                --getInstance().instanceQty;
+                getInstance().liveQty -= static_cast<int64_t>(live);
+            }
+        };
+
+
+        // 【メソッド】唯一のインスタンスの参照を返す
+        static Budget& getInstance()
+        {
+            static Budget inst;
+            return inst;
+        }
+
+
+        // 【セッタ】上限と目標。メソッドチェーン方式（どれも0で無効）
+        // 生存粒子数の合計の上限
+        Budget& maxParticles(size_t qty)     { std::lock_guard<std::mutex> lock(mutex); maxLiveQty  = qty; return *this; }
+
+        // 1フレームの生成数の合計の上限
+        Budget& maxSpawnPerFrame(size_t qty) { std::lock_guard<std::mutex> lock(mutex); maxSpawnQty = qty; return *this; }
+
+        // updateとdrawの計測時間の合計の目標（ミリ秒）。超えたフレームの次から品質を下げる
+        Budget& targetFrameTime(double ms)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            targetMs = std::max(ms, 0.0);
+            if (targetMs <= 0.0) qualityRate = 1.0;
+            return *this;
+        }
+
+        // 品質の下限。0.0 ～ 1.0
+        Budget& minQuality(double rate)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            minQualityRate = std::clamp(rate, 0.0, 1.0);
+            return *this;
+        }
+
+
+        // 【メソッド】フレームの切りかえ
+        // 通常はSystem::FrameCountの変化で自動的に切りかわる。1フレームに何度もupdateする場合などに、ループの最初で呼ぶ
+        void beginFrame()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            frame = s3d::System::FrameCount();
+            rollFrame();
+        }
+
+
+        // 【ゲッタ】
+        double quality()          const { return qualityRate.load(); }                              // 品質
+        double frameTime()        const { return lastCostMs.load(); }                                    // 前回のフレームの計測時間（ミリ秒）
+        size_t liveQuantity()     const { return static_cast<size_t>(std::max<int64_t>(liveQty.load(), 0)); }  // 生存粒子数の合計
+        size_t instanceQuantity() const { return instanceQty.load(); }                              // 登録中のインスタンス数
+
+
+        // 【メソッド】優先度に応じた品質（生成数や描画の手間に掛ける）
+        double qualityOf(BudgetPriority priority) const
+        {
+            double quality = qualityRate.load();
+            switch (priority) {
+            case BudgetPriority::Low:    return quality * quality;
+            case BudgetPriority::Normal: return quality;
+            default:                     return 1.0;
+            }
+        }
+
+
+        // 【メソッド】生成数を割り当てる。割り当てた分は生存粒子数に予約する
+        // ＜引数＞
+        // ticket   --- 生成するインスタンスの登録証
+        // quantity --- 生成したい数
+        // ＜戻り値＞ 生成してよい数
+        int grant(Ticket& ticket, int quantity)
+        {
+            if (quantity < 1) return 0;
+
+            std::lock_guard<std::mutex> lock(mutex);
+            followFrame();
+
+            // 品質で減らす（端数は持ち越すので、create(1)の連続でも割合どおりに生成される）
+            double rate = qualityOf(ticket.priority);
+            size_t qty  = static_cast<size_t>(quantity);
+            if (rate < 1.0) {
+                double want  = quantity * rate + ticket.carry;
+                qty          = static_cast<size_t>(want);
+                ticket.carry = want - qty;
+            }
+
+            // 上限で減らす（優先度の低いインスタンスは上限の一部しか使えない）
+            double headroom = headroomOf(ticket.priority);
+            if (maxLiveQty > 0) {
+                size_t limit = static_cast<size_t>(maxLiveQty * headroom);
+                size_t live  = liveQuantity();
+                qty = std::min(qty, (limit > live) ? limit - live : size_t(0));
+            }
+            if (maxSpawnQty > 0) {
+                size_t limit = static_cast<size_t>(maxSpawnQty * headroom);
+                qty = std::min(qty, (limit > spawnQty) ? limit - spawnQty : size_t(0));
+            }
+
+            spawnQty    += qty;
+            liveQty     += static_cast<int64_t>(qty);
+            ticket.live += qty;
+            return static_cast<int>(qty);
+        }
+
+
+        // 【メソッド】インスタンスの生存粒子数を知らせる（予約との差を合計に反映する）
+        void report(Ticket& ticket, size_t qty)
+        {
+            liveQty += static_cast<int64_t>(qty) - static_cast<int64_t>(ticket.live);
+            ticket.live = qty;
+        }
+    };
+
+
+
+
+
+    /////////////////////////////////////////////////////////////////////////////////////
+    // 【クラス】スレッドプール（すべてのインスタンスとManagerで共通。シングルトン）
+    // 常駐するスレッドが条件変数で待ち、仕事が来たら0 ～ 仕事数-1 の番号を取り合って処理する。
+    // 呼んだスレッドも一緒に処理し、全員が終わるまで戻らない。フレームごとのスレッド生成は行わない。
+    // プールのスレッドの中から呼んだとき（Managerの並列更新中など）や、別の仕事の実行中は、
+    // 呼んだスレッドだけで順に処理する（スレッド数を超えて並列にしない）
+    //
+    class WorkerPool
+    {
+    private:
+        // 【内部フィールド】
+        std::vector<std::thread> workers;
+        std::mutex               runMutex;    // 同時に実行する仕事は1つ
+        std::mutex               mutex;       // 以下の仕事の情報用
+        std::condition_variable  wake;        // 仕事が来た、または終了
+        std::condition_variable  done;        // プールのスレッドが仕事を終えた
+        void (*call)(void* body, size_t index);
+        void*                    body;
+        size_t                   taskQty;     // 仕事数
+        std::atomic<size_t>      next;        // 次に取る番号
+        uint64                   generation;  // 仕事の通し番号（スレッドが同じ仕事を2回取らないように）
+        size_t                   joinedQty;   // 今の仕事を取りに来たスレッド数
+        size_t                   busyQty;     // 今の仕事を処理中のスレッド数
+        size_t                   threadQty;   // 使うスレッド数（呼んだスレッドを含む。0でハードウェアのスレッド数）
+        bool                     stopping;
+
+        WorkerPool() :
+            call(nullptr), body(nullptr), taskQty(0), next(0), generation(0), joinedQty(0), busyQty(0),
+            threadQty(0), stopping(false)
+        {}
+
+        ~WorkerPool()
+        {
+            stop();
+        }
+
+
+        // 【内部メソッド】このスレッドがプールのスレッドかどうか
+        static bool& isWorkerThread()
+        {
+            thread_local bool isWorker = false;
+            return isWorker;
+        }
+
+
+        // 【内部メソッド】番号を取り合って処理する
+        void drain()
+        {
+            for (size_t i = next++; i < taskQty; i = next++)
+                call(body, i);
+        }
+
+
+        // 【内部メソッド】プールのスレッドの本体。仕事が来るまで待つ
+        // ＜引数＞
+        // seen --- 起こした時点の仕事の通し番号（それより前の仕事は取らない）
+        void loop(uint64 seen)
+        {
+            isWorkerThread() = true;
+            for (;;) {
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    wake.wait(lock, [&]() { return stopping || (generation != seen); });
+                    if (stopping) return;
+                    seen = generation;
+                    ++joinedQty;
+                    ++busyQty;
+                }
+                drain();
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    --busyQty;
+                }
+                done.notify_all();
+            }
+        }
+
+
+        // 【内部メソッド】スレッドを起こす（まだなら）
+        void start()
+        {
+            if (!workers.empty()) return;
+            size_t qty = (threadQty > 0) ? threadQty : std::max(std::thread::hardware_concurrency(), 1u);
+            uint64 seen;
+            {
+                // threadsで作り直したスレッドが、終わった仕事を取りに行かないように、今の通し番号から始める
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = false;
+                seen     = generation;
+            }
+            for (size_t i = 1; i < qty; ++i)
+                workers.emplace_back([this, seen]() { loop(seen); });
+        }
+
+
+        // 【内部メソッド】スレッドを終了させる
+        void stop()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            wake.notify_all();
+            for (auto& worker : workers) worker.join();
+            workers.clear();
+        }
+
+
+    public:
+        // 【メソッド】唯一のインスタンスの参照を返す
+        static WorkerPool& getInstance()
+        {
+            static WorkerPool inst;
+            return inst;
+        }
+
+
+        // 【セッタ】使うスレッド数（呼んだスレッドを含む）。0でハードウェアのスレッド数（既定）、1で並列にしない
+        WorkerPool& threads(size_t qty)
+        {
+            std::lock_guard<std::mutex> runLock(runMutex);
+            if (qty == threadQty) return *this;
+            stop();
+            threadQty = qty;
+            return *this;
+        }
+
+
+        // 【ゲッタ】このスレッドがプールのスレッドかどうか（入れ子の並列を避ける用）
+        bool isInsideWorker() const { return isWorkerThread(); }
+
+        // 【ゲッタ】使うスレッド数（呼んだスレッドを含む）
+        size_t threadQuantity() const
+        {
+            return (threadQty > 0) ? threadQty : std::max<size_t>(std::thread::hardware_concurrency(), 1);
+        }
+
+
+        // 【メソッド】0 ～ qty-1 の仕事を、プールのスレッドと呼んだスレッドで処理する。全員が終わるまで戻らない
+        // ＜引数＞
+        // qty  --- 仕事数
+        // task --- task(番号)。番号ごとに1回呼ばれる。順番は決まらない
+        template<typename F>
+        void run(size_t qty, F&& task)
+        {
+            if (qty == 0) return;
+            if ((qty == 1) || (threadQuantity() < 2) || isWorkerThread() || !runMutex.try_lock()) {
+                for (size_t i = 0; i < qty; ++i) task(i);  // 並列にしない
+                return;
+            }
+            std::lock_guard<std::mutex> runLock(runMutex, std::adopt_lock);
+            start();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                call      = [](void* body, size_t index) { (*static_cast<std::remove_reference_t<F>*>(body))(index); };
+                body      = &task;
+                taskQty   = qty;
+                next      = 0;
+                joinedQty = 0;
+                ++generation;
+            }
+            wake.notify_all();
+            drain();
+
+            // プールのスレッドが全員この仕事を取りに来て、終わるまで待つ（taskは呼んだスレッドのスタックにある）
+            std::unique_lock<std::mutex> lock(mutex);
+            done.wait(lock, [&]() { return (joinedQty == workers.size()) && (busyQty == 0); });
+        }
+    };
+
+
+
+
+
+    class Manager;
+    class DotCanvas;
+
+
+
+    /////////////////////////////////////////////////////////////////////////////////////
+    // 【基底クラス】すべてのパーティクルの元となるクラス。単独利用不可
+    //
+    class Works
+    {
+        friend class Manager;
+        friend class DotCanvas;
+
+    protected:
+        KotsubuMath& math = KotsubuMath::getInstance();
+        Budget& budget = Budget::getInstance();
+
+        // 【内部定数】
+        static inline const Real Pi = Real(3.141592653589793);
+        static inline const Real TwoPi = Pi * Real(2.0);            // Radianの最大値
+        static inline const Real Deg2Rad = Pi / Real(180.0);        // Degに掛けるとRad
+        static inline const Real Rad2Deg = Real(180.0) / Pi;        // Radに掛けるとDeg
+        static inline const Real RootTwo = Real(1.414213562373095); // 斜辺が45°の直角三角形における、斜辺の比（他の辺は共に1）
+        static inline const Real One  = 1.0;                        // 1.0
+        static inline const Real Half = 0.5;                        // 0.5
+        static inline const Real FrameSecOf60Fps  = Real(1.0 / 60); // 60FPSのときの1フレームの秒数
+        static inline const Real ReflectionPowerRate = Real(0.8);
+        static inline const Real FadeoutLimit        = Real(0.01);
+        static inline const Real WorldMargin         = 30.0;
+        static inline const Real SleepDistance       = Real(0.05);  // 1ステップの移動量がこれ以下なら静か（60FPSの1フレームあたり）
+        static constexpr uint8   SleepSteps          = 8;           // 静かなステップがこれだけ続いたら休止する
+
+
+
+        // 【内部構造体】粒子パラメータ、全体パラメータ
+        struct Element
+        {
+            RealVec2  pos;
+            RealVec2  oldPos;
+            Real      radian;
+            Real      speed;
+            RealColor color;
+            Real      gravity;
+            Real      liveTime;
+            bool      fadeout;
+            bool      enable;
+            uint8     quietSteps;  // 移動量の小さいステップが続いた数（休止の判定。boolの後の隙間に収まる）
+            uint8     stepPhase;   // 視野外で処理するステップの位相（生成時に決める。並び替えでは変わらない）
+            Element() :
+                pos(RealVec2(0, 0)), oldPos(RealVec2(0, 0)), radian(0.0), speed(5.0),
+                color(RealColor(1.0, 0.9, 0.6, 0.8)), gravity(0.0),
+                liveTime(0.0), fadeout(false), enable(true), quietSteps(0), stepPhase(0)
+            {}
+            Element(RealVec2 _pos, Real _radian, Real _speed, RealColor _color) :
+                pos(_pos), oldPos(_pos), radian(_radian), speed(_speed), color(_color), gravity(0.0),
+                liveTime(0.0), fadeout(false), enable(true), quietSteps(0), stepPhase(0)
+            {}
+        };
+
+
+        struct Property
+        {
+            Real       randPow;
+            Real       radianRange;
+            Real       accelSpeed;
+            RealColor  accelColor;
+            Real       gravityPower;
+            Real       gravityRad;
+            Real       fadeoutTime;
+            Real       fadeoutRate;
+            BlendState blendState;
+            Property() :
+                randPow(3.0), radianRange(TwoPi),
+                accelSpeed(Real(-0.1)), accelColor(-0.01, -0.02, -0.03, -0.001),
+                gravityPower(Real(0.2)), gravityRad(Pi / Real(2.0)), 
+                fadeoutTime(1.0), fadeoutRate(Real(0.975)),
+                blendState(s3d::BlendState::Additive)
+            {}
+        };
+
+
+        // 固定容量プール。有効時は粒子配列の再確保を一切行わない
+        struct Pool
+        {
+            bool     fixed;               // 固定容量モードかどうか
+            size_t   capacity;            // 最大粒子数
+            Overflow overflow;            // 満杯時の動作
+            std::vector<size_t> victims;  // 置きかえ対象の添え字（容量分を確保済み）
+            size_t   victimCursor;        // 次に置きかえる victims の位置
+            Pool() :
+                fixed(false), capacity(0), overflow(Overflow::Reject), victimCursor(0)
+            {}
+        };
+
+
+
+        // 固定タイムステップ。有効時は一定間隔でシミュレーションし、描画は補間する
+        struct Timestep
+        {
+            bool   fixed;        // 固定タイムステップかどうか
+            double stepSec;      // 1ステップの秒数
+            int    maxStepQty;   // 1回のupdateで処理する最大ステップ数（追いつきの上限）
+            double accumulator;  // 未処理の経過時間
+            Real   alpha;        // 描画時の補間率（oldPos 0.0 ～ 1.0 pos）
+            Timestep() :
+                fixed(false), stepSec(FrameSecOf60Fps), maxStepQty(4), accumulator(0.0), alpha(1.0)
+            {}
+        };
+
+
+
+        // 点系パーティクルのイメージに点を打った範囲（イメージの座標。right、bottomは含まない）
+        // 次のフレームは前回の範囲だけをクリアし、前回と今回を合わせた範囲だけをテクスチャに転送する
+        struct DirtyRegion
+        {
+            int32 left, top, right, bottom;              // 今回
+            int32 oldLeft, oldTop, oldRight, oldBottom;  // 前回
+            DirtyRegion() :
+                left(0), top(0), right(0), bottom(0), oldLeft(0), oldTop(0), oldRight(0), oldBottom(0)
+            {}
+
+            void add(const Point& point)
+            {
+                left   = std::min(left,   point.x);
+                top    = std::min(top,    point.y);
+                right  = std::max(right,  point.x + 1);
+                bottom = std::max(bottom, point.y + 1);
+            }
+        };
+
+
+
+        // 非同期アップデート。常駐するスレッドが条件変数で待ち、startのたびに次のフレームを進める
+        // 描画は開始時の粒子（もう一方のバッファ）から行う。複製したインスタンスには、スレッドを引き継がない
+        struct Async
+        {
+            std::thread             worker;    // 常駐するスレッド（最初のstartで起こす）
+            std::mutex              mutex;     // 以下の仕事の情報用
+            std::condition_variable wake;      // 仕事が来た、または終了
+            std::condition_variable done;      // 仕事が終わった
+            void  (*call)(Works* works, double deltaSec);
+            Works*  owner;
+            double  deltaSec;
+            bool    hasJob;    // 仕事があるかどうか（終わったらスレッドがfalseにする）
+            bool    stopping;  // スレッドを終了させる
+            bool    running;   // アップデート中かどうか（メインスレッドだけが読み書きする）
+            Real    alpha;     // 開始時の描画の補間率
+            Async() :
+                call(nullptr), owner(nullptr), deltaSec(0.0), hasJob(false), stopping(false), running(false), alpha(1.0)
+            {}
+            Async(const Async&) : Async()
+            {}
+            Async& operator=(const Async&) = delete;
+            ~Async()
+            {
+                if (!worker.joinable()) return;
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    stopping = true;
+                }
+                wake.notify_all();
+                worker.join();
+            }
+
+            // 仕事を渡す（スレッドが無ければ起こす）
+            void start(Works* works, void (*body)(Works*, double), double delta)
+            {
+                if (!worker.joinable()) worker = std::thread([this]() { loop(); });
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    owner    = works;
+                    call     = body;
+                    deltaSec = delta;
+                    hasJob   = true;
+                }
+                running = true;
+                wake.notify_one();
+            }
+
+            // 仕事が終わるまで待つ
+            void join()
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                done.wait(lock, [this]() { return !hasJob; });
+                running = false;
+            }
+
+            // スレッドの本体。仕事が来るまで待つ
+            void loop()
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                for (;;) {
+                    wake.wait(lock, [this]() { return hasJob || stopping; });
+                    if (stopping) return;
+                    lock.unlock();
+                    call(owner, deltaSec);
+                    lock.lock();
+                    hasJob = false;
+                    done.notify_all();
+                }
+            }
+        };
+
+
+
+        // 力場の種類
+        enum class FieldType
+        {
+            Attractor,  // 中心へ引き寄せる（強さが負なら押しのける）
+            Vortex,     // 中心の周りを回す（強さが正なら時計回り）
+            Wind,       // 矩形の中で一定の向きに押す
+            Drag        // 矩形の中で減速させる
+        };
+
+
+        // 力場。粒子は外接矩形の中にあるときだけ計算する
+        struct ForceField
+        {
+            FieldType type;
+            Real left, top, right, bottom;  // 影響範囲の外接矩形
+            Real x, y;                      // 中心（Attractor、Vortex）
+            Real radius;                    // 半径（Attractor、Vortex）
+            Real powerX, powerY;            // 強さ。Windは向きを含む。Dragは減衰率（powerXのみ）
+            Real falloff;                   // 減衰の指数。強さは「power * (1 - 距離 / radius)^falloff」
+        };
+
+
+        // 乱流。カールノイズ（渦の多い流れ）を、敷き詰められる正方形の格子に焼き込んでおき、
+        // 粒子ごとの計算は格子の双線形補間1回だけにする
+        struct FlowField
+        {
+            bool     enable;     // 乱流を加えるかどうか
+            size_t   gridSize;   // 格子の一辺の数（2のべき乗）
+            Real     cellSize;   // 格子1マスの大きさ（ピクセル）
+            Real     power;      // 最大の移動量（60FPSの1フレームあたりのピクセル）
+            RealVec2 scroll;     // 流れ場を動かす速さ（1秒あたりのピクセル）
+            RealVec2 offset;     // 流れ場の現在のずれ（ピクセル）
+            std::vector<RealVec2> grid;  // 格子点ごとの流れ（長さは最大1）
+            FlowField() :
+                enable(false), gridSize(0), cellSize(32.0), power(1.0), scroll(0.0, -20.0), offset(0.0, 0.0)
+            {}
+        };
+
+
+        // サブエミッタ。発動した粒子の位置と向きから、別の（または同じ）インスタンスに粒子を生成する
+        // 生成先の型は登録時に決まるので、関数ポインタで呼び分ける（仮想関数は使わない）
+        struct SubEmitter
+        {
+            Works*  target;        // 生成先
+            SubEmit trigger;       // 発動する条件
+            int     quantity;      // 1回に生成する数
+            Real    inheritSpeed;  // 発動した粒子の速度を、生成先の速度に加える割合
+            Real    interval;      // SubEmit::Timerの間隔（秒）
+            void  (*emit)(Works* target, Vec2 pos, double degree, double addSpeed, int quantity);
+        };
+
+
+        // サブエミッタの発動記録（座標と速度は、粒子の座標系のまま）
+        struct SubEmitEvent
+        {
+            RealVec2 pos;
+            Real     radian;   // 移動の向き
+            Real     speed;    // 60FPSの1フレームあたりの移動量
+            size_t   emitter;  // subEmittersの添え字
+        };
+
+
+        // 世界の範囲とカメラの視野（ウィンドウ座標。Camera2Dを使う場合はワールド座標）
+        struct World
+        {
+            bool              bounded;      // 世界の範囲を指定したかどうか（falseならウィンドウ、Dotはイメージの範囲）
+            KotsubuMath::Rect bounds;       // 世界の範囲。この外（＋余白）に出た粒子は無効
+            bool              viewing;      // カメラの視野を指定したかどうか
+            KotsubuMath::Rect view;         // カメラの視野。この外の粒子は描画しない
+            int               farInterval;  // 視野外の粒子を処理する間隔（ステップ数。1で毎ステップ）
+            size_t            stepCount;    // 間引く位相
+            uint8             spawnPhase;   // 次に生成する粒子の位相（生成ごとに進めて、粒子の番をずらす）
+            World() :
+                bounded(false), viewing(false), farInterval(1), stepCount(0), spawnPhase(0)
+            {}
+        };
+
+
+        // 粒子同士の相互作用。毎ステップ作り直す空間ハッシュで近傍の粒子だけを調べる
+        struct Interaction
+        {
+            bool   enable;         // 相互作用を行うかどうか
+            Real   radius;         // 影響半径（＝ハッシュのセルの大きさ）
+            Real   power;          // 正で反発、負で引き合う（60FPSの1フレームあたりの速度変化）
+            Real   falloff;        // 減衰の指数。力は「power * (1 - 距離 / radius)^falloff」
+            size_t neighborLimit;  // 1粒子が調べる近傍の上限（密集しても処理量を粒子数に比例させる）
+
+            // 空間ハッシュ（配列は使い回す）
+            std::vector<std::uint32_t> cellOf;     // 粒子ごとのバケット番号
+            std::vector<size_t>        cellStart;  // バケットごとの開始位置（バケット数 + 1）
+            std::vector<size_t>        order;      // バケット順に並べた粒子の添え字
+            std::vector<Real>          sortedX;    // バケット順に並べた座標
+            std::vector<Real>          sortedY;
+            std::vector<RealVec2>      impulse;    // 粒子ごとの速度変化
+            Interaction() :
+                enable(false), radius(10.0), power(0.5), falloff(1.0), neighborLimit(32)
+            {}
+        };
+
+
+
+        // 【内部フィールド】プール
+        Pool pool;
+
+        // 【内部フィールド】粒子の予算の登録証
+        Budget::Ticket budgetTicket;
+
+        // 【内部フィールド】タイムステップ
+        Timestep timestep;
+
+        // 【内部フィールド】非同期アップデート
+        Async async;
+
+        // 【内部フィールド】乱流
+        FlowField flowField;
+
+        // 【内部フィールド】世界の範囲とカメラの視野
+        World world;
+
+        // 【内部フィールド】粒子同士の相互作用
+        Interaction interaction;
+
+        // 【内部フィールド】サブエミッタと、1回のupdateで溜める発動記録（上限を超えた分は捨てる）
+        std::vector<SubEmitter>   subEmitters;
+        std::vector<SubEmitEvent> subEmitEvents;
+        size_t subEmitCapacity;
+
+        // 【内部フィールド】サブエミッタの生成をupdateの後回しにするかどうか（Managerが並列に更新する間だけtrue）
+        bool isDeferSubEmit;
+
+        // 【内部フィールド】粒子の座標からウィンドウの座標への倍率（DotはdotScale。updateの最初に設定）
+        Real worldScale;
+
+        // 【内部フィールド】reverseDirectionを呼んだ回数（衝突があったかどうかを、差で調べる）
+        size_t hitCount;
+
+        // 【内部フィールド】休止。静止した粒子は配列の先頭（0 ～ sleepQty-1）に集め、色などの経過処理と領域外の判定だけを行う
+        bool          isSleep;            // 休止を使うかどうか
+        bool          canSleep;           // 今回のupdateで休止できるかどうか（動きを変えうるものが無い）
+        size_t        sleepQty;           // 休止中の粒子数
+        std::uint64_t obstacleSignature;  // 前回のupdateの障害物（変わったら全員を起こす）
+
+        // 【内部フィールド】衝突の記録（容量が0なら記録しない。updateの最初に空にする）
+        std::vector<CollisionEvent> collisionEvents;
+        size_t collisionCapacity;
+        bool   isCountHits;                                          // 障害物ごとの衝突回数を数えるかどうか
+        std::array<std::vector<uint32>, ObstacleTypeQty> hitCounts;  // 種類ごと、登録順
+        std::array<size_t, ObstacleTypeQty> obstacleShift;           // rotateObstaclesでずらした量（登録順に戻すため）
+
+        // 【内部フィールド】力場（registForce～で登録。ステップごとの強さはstepFieldsに求める）
+        std::vector<ForceField> forceFields;
+        std::vector<ForceField> stepFields;
+
+        // 【内部フィールド】力場を一括で適用するための、粒子の並び（SoA。applyForceFieldsで使い回す）
+        struct FieldBatch
+        {
+            std::vector<Real>         xs, ys;      // 座標
+            std::vector<Real>         dvxs, dvys;  // 速度変化の合計
+            std::vector<Real>         keeps;       // 残る速度の割合（Drag）
+            std::vector<std::uint8_t> hits;        // 力を受けたかどうか
+        } fieldBatch;
+
+        // 【内部フィールド】衝突判定用
+        std::vector<KotsubuMath::Line>   obstacleLines;
+        std::vector<KotsubuMath::Rect>   obstacleRects;
+        std::vector<KotsubuMath::Circle> obstacleCircles;
+        std::vector<std::vector<RealVec2>> obstaclePolygons;
+        std::vector<std::vector<RealVec2>> obstaclePolylines;
+
+        // 【内部フィールド】一括判定用に並べ直した障害物（beginCollisionで作成）
+        KotsubuMath::PackedLines packedLines;
+        KotsubuMath::PackedRects packedRects;
+        std::vector<KotsubuMath::PackedPolygon> packedPolygons;
+
+        // 【内部フィールド】障害物の辺の向き（beginCollisionでまとめて求め、衝突のたびには計算しない）
+        std::vector<Real>              lineDirections;
+        std::vector<std::vector<Real>> polygonEdgeDirections;
+        std::vector<std::vector<Real>> polylineEdgeDirections;
+
+
+
+        // 【内部フィールド】無効な粒子を削除するとき、並び順を保つかどうか
+        bool stableOrder;
+
+
+
+        // 【隠しコンストラクタ】
+        Works() :
+            subEmitCapacity(256), isDeferSubEmit(false), worldScale(1.0), hitCount(0),
+            isSleep(false), canSleep(false), sleepQty(0), obstacleSignature(0), collisionCapacity(0), isCountHits(false),
+            obstacleShift{}, stableOrder(true)
+        {}
+
+
+        // 【内部メソッド】
+        Real fixSize(Real size)
+        {
+            if (size < One)size = One;
+            return size;
+        }
+
+
+        Real fixSpeed(Real speed)
+        {
+            if (speed < Real(0.0))speed = Real(0.0);
+            return speed;
+        }
+
+
+        Real fixGravityPower(Real power)
+        {
+            if (power < Real(0.0)) power = Real(0.0);
+            return power;
+        }
+
+
+        Real fixRandomPower(Real power)
+        {
+            if (power < Real(0.0))power = Real(0.0);
+            return power;
+        }
+
+
+        // 【内部メソッド】公開メソッドの座標（double）から、格納用の矩形を作る
+        static KotsubuMath::Rect toRealRect(double left, double top, double right, double bottom)
+        {
+            return KotsubuMath::Rect(static_cast<Real>(left), static_cast<Real>(top),
+                                     static_cast<Real>(right), static_cast<Real>(bottom));
+        }
+
+
+        // 【内部メソッド】点系のイメージを、ウィンドウの大きさに合わせる
+        // 使う範囲（size）はウィンドウと拡大率から決め、ブランクイメージ（容量）より大きくなったときだけ作り直す。
+        // 小さくなったときは作り直さず、左上の範囲だけを使う（粒子は容量の中で生き続け、座標も変わらない）
+        // ＜引数＞
+        // blankImg --- ブランクイメージ（容量）
+        // tex      --- 動的テクスチャ（作り直したら解放する）
+        // scale    --- ドットの拡大率
+        // size     --- 使う範囲（結果）
+        // isReset  --- trueなら、容量を使う範囲ちょうどに作り直す（拡大率の変更時）
+        static void fitCanvas(Image& blankImg, DynamicTexture& tex, Real scale, Size& size, bool isReset)
+        {
+            Real rate   = One / scale;
+            Real margin = WorldMargin * Real(2.0) * rate;
+            size = Size(static_cast<int32>(s3d::Window::Width() * rate + margin),
+                        static_cast<int32>(s3d::Window::Height() * rate + margin));
+            if (!isReset && (size.x <= blankImg.width()) && (size.y <= blankImg.height())) return;
+
+            int32 width  = isReset ? size.x : std::max(size.x, blankImg.width());
+            int32 height = isReset ? size.y : std::max(size.y, blankImg.height());
+            blankImg = s3d::Image(static_cast<size_t>(width), static_cast<size_t>(height));
+
+            // 動的テクスチャは「同じサイズ」のイメージを供給しないと描画されないためリセット。
+            // また、テクスチャやイメージのreleaseやclearは、連続で呼び出すとエラーする
+            tex.release();
+        }
+
+
+        // 【内部メソッド】点を打つ前に、イメージの前回の範囲だけをクリアする
+        // イメージの大きさがブランクイメージと違えば（最初や拡大率の変更時）、全体を複製する
+        static void clearDirty(Image& img, const Image& blankImg, DirtyRegion& region)
+        {
+            if ((img.width() != blankImg.width()) || (img.height() != blankImg.height())) {
+                img = blankImg;  // clear関数もあるが連続で呼び出すとエラーする
+                region.oldLeft = region.oldTop = 0;
+                region.oldRight  = img.width();
+                region.oldBottom = img.height();
+            }
+            else {
+                for (int32 y = region.top; y < region.bottom; ++y)
+                    std::copy(blankImg[y] + region.left, blankImg[y] + region.right, img[y] + region.left);
+                region.oldLeft   = region.left;
+                region.oldTop    = region.top;
+                region.oldRight  = region.right;
+                region.oldBottom = region.bottom;
+            }
+
+            // 今回の範囲を空にする（addで広げる）
+            region.left = region.top = std::numeric_limits<int32>::max();
+            region.right = region.bottom = std::numeric_limits<int32>::min();
+        }
+
+
+        // 【内部メソッド】点を打った後に、前回と今回を合わせた範囲だけをテクスチャに転送する
+        // テクスチャが空（最初や拡大率の変更時）なら、全体を転送して作る
+        static void uploadDirty(DynamicTexture& tex, const Image& img, DirtyRegion& region)
+        {
+            if (region.left >= region.right)
+                region.left = region.top = region.right = region.bottom = 0;  // 今回は点を打っていない
+
+            if (tex.isEmpty()) {
+                tex.fill(img);
+                return;
+            }
+
+            // 前回と今回を合わせた範囲（片方が空なら、もう片方）
+            int32 left = region.left, top = region.top, right = region.right, bottom = region.bottom;
+            if (region.oldLeft < region.oldRight) {
+                if (left < right) {
+                    left   = std::min(left,   region.oldLeft);
+                    top    = std::min(top,    region.oldTop);
+                    right  = std::max(right,  region.oldRight);
+                    bottom = std::max(bottom, region.oldBottom);
+                }
+                else {
+                    left = region.oldLeft;  top = region.oldTop;  right = region.oldRight;  bottom = region.oldBottom;
+                }
+            }
+            if (left < right)
+                tex.fillRegion(img, s3d::Rect(left, top, right - left, bottom - top));
+        }
+
+
+        // 【内部定数】サブピクセル描画の重みの1.0（7ビット。16ビット整数で「差 * 重み」があふれない）
+        static constexpr int32 SplatOne = 1 << 7;
+
+
+        // 【内部メソッド】点を、周囲の4ドットに位置の小数部で分けて打つ（サブピクセル描画）
+        // ドットの中心は「整数 + 0.5」。IsAddがfalseなら重みの割合で色を寄せ、trueなら重みを掛けた色を加算する
+        // （加算の色は、あらかじめアルファを掛けておく）。イメージの外にはみ出たドットは打たない
+        // ＜引数＞
+        // img    --- 点を打つイメージ
+        // pos    --- 位置（イメージの座標）
+        // color  --- 色
+        // region --- 点を打った範囲（打ったドットの分だけ広げる）
+        template<bool IsAdd>
+        static void splatDot(Image& img, RealVec2 pos, const Color& color, DirtyRegion& region)
+        {
+            // 左上のドットと、小数部の重み（0 ～ SplatOne）
+            Real  fx = pos.x - Half;
+            Real  fy = pos.y - Half;
+            Real  floorX = std::floor(fx);
+            Real  floorY = std::floor(fy);
+            int32 x  = static_cast<int32>(floorX);
+            int32 y  = static_cast<int32>(floorY);
+            int32 wx = static_cast<int32>((fx - floorX) * SplatOne + Half);
+            int32 wy = static_cast<int32>((fy - floorY) * SplatOne + Half);
+            int32 w[4] = { ((SplatOne - wx) * (SplatOne - wy) + SplatOne / 2) >> 7,  // 左上
+                           (wx * (SplatOne - wy) + SplatOne / 2) >> 7,               // 右上
+                           ((SplatOne - wx) * wy + SplatOne / 2) >> 7,               // 左下
+                           (wx * wy + SplatOne / 2) >> 7 };                          // 右下
+
+            if ((x < -1) || (y < -1) || (x >= img.width()) || (y >= img.height())) return;
+            if ((x >= 0) && (y >= 0) && (x + 1 < img.width()) && (y + 1 < img.height())) {
+                region.add(Point(x, y));
+                region.add(Point(x + 1, y + 1));
+#ifdef KOTSUBU_PARTICLE_SSE2
+                // 上下の行の2ドットずつを、チャンネルごとの16ビット整数にして一度に処理
+                std::uint32_t bits;
+                std::memcpy(&bits, &color, sizeof(bits));
+                __m128i zero = _mm_setzero_si128();
+                __m128i src  = _mm_unpacklo_epi8(_mm_set1_epi32(static_cast<int>(bits)), zero);
+                __m128i* row0 = reinterpret_cast<__m128i*>(img[y] + x);
+                __m128i* row1 = reinterpret_cast<__m128i*>(img[y + 1] + x);
+                __m128i dst0 = _mm_unpacklo_epi8(_mm_loadl_epi64(row0), zero);
+                __m128i dst1 = _mm_unpacklo_epi8(_mm_loadl_epi64(row1), zero);
+                __m128i w0   = _mm_set_epi16(static_cast<short>(w[1]), static_cast<short>(w[1]), static_cast<short>(w[1]), static_cast<short>(w[1]),
+                                             static_cast<short>(w[0]), static_cast<short>(w[0]), static_cast<short>(w[0]), static_cast<short>(w[0]));
+                __m128i w1   = _mm_set_epi16(static_cast<short>(w[3]), static_cast<short>(w[3]), static_cast<short>(w[3]), static_cast<short>(w[3]),
+                                             static_cast<short>(w[2]), static_cast<short>(w[2]), static_cast<short>(w[2]), static_cast<short>(w[2]));
+                if constexpr (IsAdd) {
+                    dst0 = _mm_add_epi16(dst0, _mm_srli_epi16(_mm_mullo_epi16(src, w0), 7));
+                    dst1 = _mm_add_epi16(dst1, _mm_srli_epi16(_mm_mullo_epi16(src, w1), 7));
+                }
+                else {
+                    dst0 = _mm_add_epi16(dst0, _mm_srai_epi16(_mm_mullo_epi16(_mm_sub_epi16(src, dst0), w0), 7));
+                    dst1 = _mm_add_epi16(dst1, _mm_srai_epi16(_mm_mullo_epi16(_mm_sub_epi16(src, dst1), w1), 7));
+                }
+                __m128i packed = _mm_packus_epi16(dst0, dst1);  // 加算であふれた分は255で止まる
+                _mm_storel_epi64(row0, packed);
+                _mm_storel_epi64(row1, _mm_unpackhi_epi64(packed, packed));
+                return;
+#endif
+            }
+
+            // イメージの端（またはSSE2が無いとき）は1ドットずつ
+            for (int32 i = 0; i < 4; ++i) {
+                Point point(x + (i & 1), y + (i >> 1));
+                if ((point.x < 0) || (point.y < 0) || (point.x >= img.width()) || (point.y >= img.height())) continue;
+                region.add(point);
+                Color& dst = img[point];
+                dst.r = splatChannel<IsAdd>(dst.r, color.r, w[i]);
+                dst.g = splatChannel<IsAdd>(dst.g, color.g, w[i]);
+                dst.b = splatChannel<IsAdd>(dst.b, color.b, w[i]);
+                dst.a = splatChannel<IsAdd>(dst.a, color.a, w[i]);
+            }
+        }
+
+        // splatDotの1チャンネル分（SSE2と同じ整数の計算）
+        template<bool IsAdd>
+        static uint8 splatChannel(int32 dst, int32 src, int32 weight)
+        {
+            if constexpr (IsAdd) return static_cast<uint8>(std::min(dst + ((src * weight) >> 7), 255));
+            else                 return static_cast<uint8>(dst + (((src - dst) * weight) >> 7));
+        }
+
+        // 加算用に、アルファを掛けた色（アルファはそのまま）
+        static Color premultiplied(const RealColor& color)
+        {
+            return s3d::Color(ColorF(color.r * color.a, color.g * color.a, color.b * color.a, color.a));
+        }
+
+
+        // 【内部メソッド】描画の手間を、予算の品質に合わせて減らす（最低1）
+        int budgetLayers(int layerQty) const
+        {
+            return std::max(1, static_cast<int>(std::ceil(layerQty * budget.qualityOf(budgetTicket.priority))));
+        }
+
+
+        // 【内部メソッド】固定容量プールを設定
+        // capacityが0なら可変長（既定の動作）に戻す。
+        // 容量を超えている粒子は末尾から削除し、配列は容量ちょうどに確保し直す
+        template<typename T>
+        void setupPool(T& elements, size_t capacity, Overflow overflow)
+        {
+            if (capacity == 0) {
+                pool = Pool();
+                return;
+            }
+
+            if (elements.size() > capacity)
+                elements.erase(elements.begin() + capacity, elements.end());
+
+            if (elements.capacity() != capacity) {
+                T tmp;
+                tmp.reserve(capacity);
+                tmp.assign(elements.begin(), elements.end());
+                elements.swap(tmp);
+            }
+
+            pool.fixed    = true;
+            pool.capacity = capacity;
+            pool.overflow = overflow;
+            pool.victims.clear();
+            pool.victims.shrink_to_fit();
+            pool.victims.reserve(capacity);
+        }
+
+
+        // 【内部メソッド】メモリの上限（バイト）から固定容量プールを設定
+        // 粒子1個あたり「要素 + 置きかえ用の添え字」で計算する（最低でも1個）
+        template<typename T>
+        void setupPoolByBytes(T& elements, size_t bytes, Overflow overflow)
+        {
+            size_t capacity = bytes / (sizeof(typename T::value_type) + sizeof(size_t));
+            if (capacity < 1) capacity = 1;
+            setupPool(elements, capacity, overflow);
+        }
+
+
+        // 【内部メソッド】生成数を調整し、置きかえ対象の粒子を選ぶ（生成の直前に呼ぶ）
+        // ＜戻り値＞ 実際に生成する数
+        template<typename T>
+        int reserveSpawn(T& elements, int quantity)
+        {
+            pool.victims.clear();
+            pool.victimCursor = 0;
+            budget.report(budgetTicket, elements.size());
+            quantity = budget.grant(budgetTicket, quantity);
+            if (quantity < 1) return 0;
+            if (!pool.fixed) return quantity;
+
+            // 置きかえる粒子は数が増えないので、予算の予約から外す
+            size_t qty   = std::min(static_cast<size_t>(quantity), pool.capacity);
+            size_t space = pool.capacity - elements.size();
+            budget.report(budgetTicket, elements.size() + std::min(qty, space));
+            if (qty <= space) return static_cast<int>(qty);
+            if (pool.overflow == Overflow::Reject) return static_cast<int>(space);
+
+            // 置きかえる数だけ、条件に合う粒子の添え字を先頭に集める（確保済みの領域のみ使用）
+            // 休止中の粒子が置きかわると動かなくなるので、全員を起こしておく
+            size_t replaceQty = qty - space;
+            sleepQty = 0;
+            pool.victims.resize(elements.size());
+            std::iota(pool.victims.begin(), pool.victims.end(), size_t(0));
+            auto nth = pool.victims.begin() + (replaceQty - 1);
+
+            if (pool.overflow == Overflow::KillOldest) {
+                // フェードアウト中の粒子を優先し、その次は生存時間の長い順
+                std::nth_element(pool.victims.begin(), nth, pool.victims.end(),
+                    [&elements](size_t a, size_t b) -> bool {
+                        if (elements[a].fadeout != elements[b].fadeout) return elements[a].fadeout;
+                        return elements[a].liveTime > elements[b].liveTime;
+                    });
+            }
+            else {
+                std::nth_element(pool.victims.begin(), nth, pool.victims.end(),
+                    [&elements](size_t a, size_t b) { return elements[a].color.a < elements[b].color.a; });
+            }
+            pool.victims.resize(replaceQty);
+
+            return static_cast<int>(qty);
+        }
+
+
+        // 【内部メソッド】粒子を1個追加（reserveSpawnの後に呼ぶ）
+        // 満杯の固定容量プールでは、選ばれた粒子を上書きする
+        template<typename T, typename E>
+        void spawnElement(T& elements, const E& element)
+        {
+            if (!pool.fixed || elements.size() < pool.capacity)
+                elements.emplace_back(element);
+            else if (pool.victimCursor < pool.victims.size())
+                elements[pool.victims[pool.victimCursor++]] = element;
+        }
+
+
+        // 【内部メソッド】固定タイムステップを設定
+        // ＜引数＞
+        // isFixed    --- falseなら可変タイムステップ（フレームの経過時間で1回処理する。既定の動作）
+        // stepRate   --- 1秒あたりのステップ数
+        // maxStepQty --- 1回のupdateで処理する最大ステップ数。これを超えた遅れは切り捨てる
+        void setupTimestep(bool isFixed, double stepRate, int maxStepQty)
+        {
+            if (stepRate < 1.0) stepRate = 1.0;
+            if (maxStepQty < 1) maxStepQty = 1;
+
+            timestep.fixed       = isFixed;
+            timestep.stepSec     = 1.0 / stepRate;
+            timestep.maxStepQty  = maxStepQty;
+            timestep.accumulator = 0.0;
+            timestep.alpha       = One;
+        }
+
+
+        // 【内部メソッド】今回のupdateで処理するステップ数と、1ステップの秒数を求める
+        // 固定タイムステップでは経過時間を蓄積し、ステップ1回分に満たない端数を描画の補間率とする
+        int beginSteps(double deltaTimeSec, double& stepSec)
+        {
+            if (!timestep.fixed) {
+                stepSec = deltaTimeSec;
+                return 1;
+            }
+
+            timestep.accumulator += deltaTimeSec;
+            int stepQty = static_cast<int>(timestep.accumulator / timestep.stepSec);
+            if (stepQty > timestep.maxStepQty) {
+                // 追いつけない遅れは捨てる（重いフレームの後に処理が雪だるま式に増えるのを防ぐ）
+                stepQty = timestep.maxStepQty;
+                timestep.accumulator = std::fmod(timestep.accumulator, timestep.stepSec);
+            }
+            else {
+                timestep.accumulator -= timestep.stepSec * stepQty;
+            }
+
+            timestep.alpha = static_cast<Real>(timestep.accumulator / timestep.stepSec);
+            stepSec = timestep.stepSec;
+            return stepQty;
+        }
+
+
+        // 【内部メソッド】粒子の描画位置を返す
+        // 固定タイムステップでは、直前のステップ位置（oldPos）と現在位置（pos）を補間する
+        RealVec2 drawPos(const Element& element) const
+        {
+            if (!timestep.fixed) return element.pos;
+            Real alpha = async.running ? async.alpha : timestep.alpha;  // アップデート中は開始時の補間率
+            return element.oldPos + (element.pos - element.oldPos) * alpha;
+        }
+
+
+        // 【内部メソッド】全粒子の経過処理、衝突判定、無効な粒子の削除を1回の走査で行う
+        // 書き込み位置（カーソル）を生存粒子だけ進めることで、別ループでの削除を不要にしている。
+        // ＜引数＞
+        // stepElement        --- 粒子1個の経過処理。粒子が無効になったら（または処理を省いたら）falseを返す。
+        //                      falseのときは衝突判定を行わない。粒子を残すかどうかはenableで決まる
+        // restElement        --- 休止中の粒子1個の経過処理（移動しない。衝突判定も行わない）
+        // collisionTimeScale --- 衝突時の速度補正
+        // ＜並び順＞
+        // stableOrder == true  --- 生存粒子を前に詰める。並び順（＝描画順）が変わらない
+        // stableOrder == false --- 無効な粒子の位置に末尾の粒子を移して続行する。移動が少なく軽量
+        template<typename T, typename F, typename R>
+        void updateElements(T& elements, F&& stepElement, R&& restElement, Real collisionTimeScale)
+        {
+            if (subEmitters.empty()) {
+                sweepElements(elements, stepElement,
+                    [this, collisionTimeScale](Element& elm) { collideElement(elm, collisionTimeScale); }, restElement);
+                return;
+            }
+
+            // サブエミッタがあるときだけ、経過処理と衝突判定の前後を比べて発動を記録する
+            sweepElements(elements,
+                [&](auto& r) {
+                    Real before = r.liveTime;
+                    bool isStep = stepElement(r);
+                    if (!r.enable) {
+                        recordSubEmit(r, SubEmit::Death, collisionTimeScale);
+                        return false;
+                    }
+                    if (!isStep) return false;  // 処理を省いた粒子
+                    recordSubEmitTimer(r, before, collisionTimeScale);
+                    return true;
+                },
+                [&](Element& elm) {
+                    size_t hits = hitCount;
+                    collideElement(elm, collisionTimeScale);
+                    if (hitCount != hits) recordSubEmit(elm, SubEmit::Collision, collisionTimeScale);
+                    if (!elm.enable)      recordSubEmit(elm, SubEmit::Death, collisionTimeScale);
+                },
+                restElement);
+        }
+
+
+        // 【内部メソッド】条件に合うサブエミッタの発動を記録（生成はupdateの後にまとめて行う）
+        // ＜引数＞
+        // frameRate --- 1ステップの移動量を、60FPSの1フレームあたりに直す倍率
+        void recordSubEmit(const Element& elm, SubEmit trigger, Real frameRate)
+        {
+            for (size_t n = 0; n < subEmitters.size(); ++n) {
+                if (subEmitters[n].trigger != trigger) continue;
+                pushSubEmitEvent(elm, n, frameRate);
+            }
+        }
+
+
+        void recordSubEmitTimer(const Element& elm, Real before, Real frameRate)
+        {
+            for (size_t n = 0; n < subEmitters.size(); ++n) {
+                auto& se = subEmitters[n];
+                if (se.trigger != SubEmit::Timer) continue;
+                if (std::floor(elm.liveTime / se.interval) > std::floor(before / se.interval))
+                    pushSubEmitEvent(elm, n, frameRate);
+            }
+        }
+
+
+        void pushSubEmitEvent(const Element& elm, size_t emitter, Real frameRate)
+        {
+            if (subEmitEvents.size() >= subEmitCapacity) return;  // 上限を超えた分は捨てる（再確保しない）
+            RealVec2 move = elm.pos - elm.oldPos;
+            subEmitEvents.push_back({ elm.pos, math.direction(move), math.length(move) * frameRate, emitter });
+        }
+
+
+        // 【内部メソッド】溜めた発動記録から、まとめて粒子を生成する（updateの最後に呼ぶ）
+        // 生成先が自分自身でも、走査の外なので安全
+        void flushSubEmitters()
+        {
+            for (auto& e : subEmitEvents) {
+                auto& se = subEmitters[e.emitter];
+                Vec2 pos(e.pos.x * worldScale, e.pos.y * worldScale);
+                se.emit(se.target, pos, e.radian * Rad2Deg, e.speed * worldScale * se.inheritSpeed, se.quantity);
+            }
+            subEmitEvents.clear();
+        }
+
+
+        // 【内部メソッド】サブエミッタを追加
+        template<typename T>
+        void setupSubEmitter(T& target, SubEmit trigger, int quantity, double inheritSpeed, double interval)
+        {
+            SubEmitter se;
+            se.target       = &target;
+            se.trigger      = trigger;
+            se.quantity     = std::max(quantity, 0);
+            se.inheritSpeed = static_cast<Real>(inheritSpeed);
+            se.interval     = static_cast<Real>(std::max(interval, 0.001));
+            se.emit = [](Works* target, Vec2 pos, double degree, double addSpeed, int quantity) {
+                static_cast<T*>(target)->createFrom(pos, degree, addSpeed, quantity);
+            };
+            subEmitters.emplace_back(se);
+            subEmitEvents.reserve(subEmitCapacity);
+        }
+
+
+        // 【内部メソッド】updateElementsの本体。衝突判定の処理を関数で受け取る
+        // 粒子の型がElementではない場合（DotCompactなど）は、これを直接呼ぶ（休止は使わない）
+        // ＜引数＞
+        // collide --- 粒子1個の衝突判定。障害物が1つも無いときは呼ばれない
+        template<typename T, typename F, typename C>
+        void sweepElements(T& elements, F&& stepElement, C&& collide)
+        {
+            sleepQty = 0;
+            sweepElements(elements, stepElement, collide, [](auto&) { return true; });
+        }
+
+
+        // ＜引数＞
+        // restElement --- 休止中の粒子（先頭のsleepQty個）の経過処理。休止中の粒子は常に前に詰める
+        template<typename T, typename F, typename C, typename R>
+        void sweepElements(T& elements, F&& stepElement, C&& collide, R&& restElement)
+        {
+            bool   isCollision = beginCollision();
+            size_t qty  = elements.size();
+            size_t rest = std::min(sleepQty, qty);
+            size_t dst  = 0;
+            size_t i    = 0;
+            sleepQty = 0;
+
+            while (i < qty) {
+                auto& r = elements[i];
+
+                if (i < rest) {
+                    if (restElement(r)) ++sleepQty;
+                }
+                else if (stepElement(r) && isCollision) {
+                    collide(r);
+                }
+
+                if (r.enable) {
+                    if (dst != i) elements[dst] = std::move(r);
+                    ++dst;
+                    ++i;
+                }
+                else if (stableOrder || i < rest) {
+                    ++i;
+                }
+                else {
+                    // 末尾の粒子（未処理）をこの位置に移し、同じ位置をもう一度処理する
+                    --qty;
+                    if (i != qty) elements[i] = std::move(elements[qty]);
+                }
+            }
+            elements.erase(elements.begin() + dst, elements.end());
+        }
+
+
+        // 【内部メソッド】粒子同士の相互作用を設定
+        // radiusが0以下なら無効（既定の動作）
+        void setupInteraction(double radius, double power, double falloff, size_t neighborLimit)
+        {
+            interaction.enable        = (radius > 0.0);
+            interaction.radius        = static_cast<Real>(std::max(radius, 1.0));
+            interaction.power         = static_cast<Real>(power);
+            interaction.falloff       = static_cast<Real>(std::max(falloff, 0.0));
+            interaction.neighborLimit = std::max(neighborLimit, size_t(1));
+            if (!interaction.enable) interaction = Interaction();  // 使い回しの配列も解放
+        }
+
+
+        // 【内部メソッド】乱流を設定
+        // powerが0なら無効（既定の動作）。格子の大きさが変わったときだけ焼き直す
+        void setupTurbulence(double power, double cellSize, Vec2 scroll, size_t gridSize)
+        {
+            size_t size = 4;
+            while (size < gridSize) size <<= 1;
+
+            flowField.enable   = (power != 0.0);
+            flowField.power    = static_cast<Real>(power);
+            flowField.cellSize = static_cast<Real>(std::max(cellSize, 1.0));
+            flowField.scroll   = scroll;
+            if (flowField.enable && flowField.gridSize != size) bakeTurbulence(size);
+        }
+
+
+        // 【内部メソッド】カールノイズを格子に焼き込む
+        // 周期的なパーリンノイズ（数オクターブ）を流れ関数とし、その回転（curl）を差分で求める。
+        // 回転は湧き出しが無いので、粒子が1点に集まらずに渦を巻く。端は反対側とつながる
+        void bakeTurbulence(size_t gridSize)
+        {
+            static constexpr int    OctaveQty  = 3;
+            static constexpr size_t BasePeriod = 4;  // 最初のオクターブの、格子全体での周期数
+            size_t mask = gridSize - 1;
+
+            // 流れ関数
+            std::vector<Real> potential(gridSize * gridSize, 0.0);
+            Real amplitude = One;
+            for (int octave = 0; octave < OctaveQty; ++octave) {
+                size_t period = BasePeriod << octave;
+                std::vector<RealVec2> gradients(period * period);
+                for (auto& g : gradients) {
+                    Real rad = Random(TwoPi);
+                    g = RealVec2(std::cos(rad), std::sin(rad));
+                }
+
+                Real rate = static_cast<Real>(period) / gridSize;
+                for (size_t y = 0; y < gridSize; ++y) {
+                    for (size_t x = 0; x < gridSize; ++x) {
+                        Real   fx = x * rate, fy = y * rate;
+                        size_t ix = static_cast<size_t>(fx), iy = static_cast<size_t>(fy);
+                        Real   tx = fx - ix, ty = fy - iy;
+                        auto corner = [&](size_t cx, size_t cy, Real dx, Real dy) {
+                            const RealVec2& g = gradients[(cy % period) * period + (cx % period)];
+                            return g.x * dx + g.y * dy;
+                        };
+                        Real n00 = corner(ix,     iy,     tx,       ty);
+                        Real n10 = corner(ix + 1, iy,     tx - One, ty);
+                        Real n01 = corner(ix,     iy + 1, tx,       ty - One);
+                        Real n11 = corner(ix + 1, iy + 1, tx - One, ty - One);
+                        Real sx = tx * tx * tx * (tx * (tx * 6 - 15) + 10);  // 補間曲線 6t^5 - 15t^4 + 10t^3
+                        Real sy = ty * ty * ty * (ty * (ty * 6 - 15) + 10);
+                        Real top    = n00 + (n10 - n00) * sx;
+                        Real bottom = n01 + (n11 - n01) * sx;
+                        potential[y * gridSize + x] += (top + (bottom - top) * sy) * amplitude;
+                    }
+                }
+                amplitude *= Half;
+            }
+
+            // 回転（∂ψ/∂y, -∂ψ/∂x）。最も強い流れが長さ1になるよう正規化する
+            flowField.grid.resize(gridSize * gridSize);
+            Real maxLenPow = 0.0;
+            for (size_t y = 0; y < gridSize; ++y) {
+                for (size_t x = 0; x < gridSize; ++x) {
+                    Real dx = potential[y * gridSize + ((x + 1) & mask)] - potential[y * gridSize + ((x - 1) & mask)];
+                    Real dy = potential[((y + 1) & mask) * gridSize + x] - potential[((y - 1) & mask) * gridSize + x];
+                    RealVec2 flow(dy, -dx);
+                    flowField.grid[y * gridSize + x] = flow;
+                    maxLenPow = std::max(maxLenPow, flow.x * flow.x + flow.y * flow.y);
+                }
+            }
+            if (maxLenPow > Real(0.0)) {
+                Real rate = One / std::sqrt(maxLenPow);
+                for (auto& flow : flowField.grid) flow *= rate;
+            }
+            flowField.gridSize = gridSize;
+        }
+
+
+        // 【内部メソッド】乱流を1ステップ分動かす（ずれは格子1周で折り返し、精度を保つ）
+        void scrollTurbulence(double delta)
+        {
+            if (!flowField.enable) return;
+            Real tileSize = flowField.cellSize * flowField.gridSize;
+            flowField.offset += flowField.scroll * static_cast<Real>(delta);
+            flowField.offset.x -= std::floor(flowField.offset.x / tileSize) * tileSize;
+            flowField.offset.y -= std::floor(flowField.offset.y / tileSize) * tileSize;
+        }
+
+
+        // 【内部メソッド】位置の乱流を返す（格子の双線形補間）
+        // ＜引数＞
+        // invCell --- 格子1マスの大きさの逆数（粒子の座標系での値）
+        // shift   --- 流れ場のずれ（粒子の座標系での値）
+        RealVec2 sampleTurbulence(RealVec2 pos, Real invCell, RealVec2 shift) const
+        {
+            size_t mask = flowField.gridSize - 1;
+            Real fx = (pos.x + shift.x) * invCell;
+            Real fy = (pos.y + shift.y) * invCell;
+            Real bx = std::floor(fx), by = std::floor(fy);
+            Real tx = fx - bx, ty = fy - by;
+            size_t x0 = static_cast<size_t>(static_cast<std::int64_t>(bx)) & mask, x1 = (x0 + 1) & mask;
+            size_t y0 = static_cast<size_t>(static_cast<std::int64_t>(by)) & mask, y1 = (y0 + 1) & mask;
+
+            const RealVec2* grid = flowField.grid.data();
+            size_t size = flowField.gridSize;
+            RealVec2 top    = grid[y0 * size + x0] + (grid[y0 * size + x1] - grid[y0 * size + x0]) * tx;
+            RealVec2 bottom = grid[y1 * size + x0] + (grid[y1 * size + x1] - grid[y1 * size + x0]) * tx;
+            return top + (bottom - top) * ty;
+        }
+
+
+        // 【内部メソッド】0 ～ qty-1 を区間に分け、WorkerPoolのスレッドで処理する（スレッドは生成しない）
+        // 少ないときや、プールのスレッドの中（Managerの並列更新中）では、分けずにこのスレッドで処理する
+        // ＜引数＞
+        // body --- body(開始, 終了)。区間ごとに呼ばれる。区間をまたいで同じ場所に書き込まないこと
+        template<typename F>
+        static void parallelRanges(size_t qty, F&& body)
+        {
+            static constexpr size_t MinChunk = 4096;
+            WorkerPool& pool     = WorkerPool::getInstance();
+            size_t      rangeQty = std::min(pool.threadQuantity(), qty / MinChunk);
+            if ((rangeQty < 2) || pool.isInsideWorker()) {
+                body(size_t(0), qty);
+                return;
+            }
+
+            size_t chunk = (qty + rangeQty - 1) / rangeQty;
+            pool.run(rangeQty, [&body, chunk, qty](size_t n) {
+                size_t begin = n * chunk;
+                if (begin < qty) body(begin, std::min(begin + chunk, qty));
+            });
+        }
+
+
+        // 【内部メソッド】力場を適用（移動の後に全粒子を走査する）
+        // 力場ごとに全粒子の速度変化をSoAの配列に合計し、最後に力を受けた粒子だけ進行方向と速度に合成する
+        template<typename T>
+        void applyForceFields(T& elements, Real timeScale)
+        {
+            if (forceFields.empty()) return;
+
+            // 強さをこのステップの分にしておく（Dragは「1ステップで残る速度の割合」）
+            stepFields.assign(forceFields.begin(), forceFields.end());
+            for (auto& f : stepFields) {
+                if (f.type == FieldType::Drag) {
+                    f.powerX = std::pow(One - f.powerX, timeScale);
+                }
+                else {
+                    f.powerX *= timeScale;
+                    f.powerY *= timeScale;
+                }
+            }
+
+            // 粒子の座標と速度変化を、力場ごとに全粒子をまとめて処理できる並び（SoA）にする
+            size_t qty = elements.size();
+            fieldBatch.xs.resize(qty);
+            fieldBatch.ys.resize(qty);
+            fieldBatch.dvxs.resize(qty);
+            fieldBatch.dvys.resize(qty);
+            fieldBatch.keeps.resize(qty);
+            fieldBatch.hits.resize(qty);
+
+            // 区間ごとに、力場を1つずつ全粒子に適用する（内側のループは分岐なし。放射状の力はAVX2で一括）
+            parallelRanges(qty, [&](size_t begin, size_t end) {
+                Real*         xs    = fieldBatch.xs.data();
+                Real*         ys    = fieldBatch.ys.data();
+                Real*         dvxs  = fieldBatch.dvxs.data();
+                Real*         dvys  = fieldBatch.dvys.data();
+                Real*         keeps = fieldBatch.keeps.data();
+                std::uint8_t* hits  = fieldBatch.hits.data();
+                for (size_t i = begin; i < end; ++i) {
+                    xs[i]    = elements[i].pos.x;
+                    ys[i]    = elements[i].pos.y;
+                    dvxs[i]  = 0.0;
+                    dvys[i]  = 0.0;
+                    keeps[i] = One;
+                    hits[i]  = 0;
+                }
+
+                size_t n = end - begin;
+                for (auto& f : stepFields) {
+                    if (f.type == FieldType::Attractor || f.type == FieldType::Vortex) {
+                        math.radialForces(&xs[begin], &ys[begin], n, RealVec2(f.x, f.y), f.radius, f.powerX, f.falloff,
+                                          f.type == FieldType::Vortex, &dvxs[begin], &dvys[begin], &hits[begin]);
+                        continue;
+                    }
+                    bool isWind = (f.type == FieldType::Wind);
+                    Real addX   = isWind ? f.powerX : Real(0.0);
+                    Real addY   = isWind ? f.powerY : Real(0.0);
+                    Real mulK   = isWind ? One : f.powerX;
+                    for (size_t i = begin; i < end; ++i) {
+                        bool inside = (xs[i] >= f.left) & (xs[i] <= f.right) & (ys[i] >= f.top) & (ys[i] <= f.bottom);
+                        dvxs[i]  += inside ? addX : Real(0.0);
+                        dvys[i]  += inside ? addY : Real(0.0);
+                        keeps[i] *= inside ? mulK : One;
+                        hits[i]  |= static_cast<std::uint8_t>(inside);
+                    }
+                }
+
+                // 力を受けた粒子だけ、進行方向と速度に合成する
+                for (size_t i = begin; i < end; ++i) {
+                    if (!hits[i]) continue;
+                    auto& r = elements[i];
+                    RealVec2 move(std::cos(r.radian) * r.speed + dvxs[i], std::sin(r.radian) * r.speed + dvys[i]);
+                    r.radian = math.direction(move);
+                    r.speed  = math.length(move) * keeps[i];
+                }
+            });
+        }
+
+
+        // 【内部メソッド】粒子同士の相互作用（近傍の粒子から受ける力で、進行方向と速度を変える）
+        // 空間ハッシュは計数ソートで作るので、粒子数nに対してO(n)。
+        // 近傍の探索はバケット順の区間ごとに並列で行い、結果は粒子ごとの配列に書き込むだけなので競合しない
+        // ＜引数＞
+        // scale --- 座標の縮小率（Dotはイメージの座標なので、半径と強さをdotScaleで割る。speedと同じ）
+        template<typename T>
+        void interactElements(T& elements, Real timeScale, Real scale)
+        {
+            auto&  it  = interaction;
+            size_t qty = elements.size();
+            if (!it.enable || qty < 2) return;
+
+            // バケット数は粒子数以上の2のべき乗
+            size_t bucketQty = 1;
+            while (bucketQty < qty) bucketQty <<= 1;
+            std::uint32_t bucketMask = static_cast<std::uint32_t>(bucketQty - 1);
+            Real radius  = it.radius / scale;
+            Real invCell = One / radius;
+            auto bucketOf = [bucketMask](std::int32_t cx, std::int32_t cy) -> std::uint32_t {
+                std::uint32_t h = static_cast<std::uint32_t>(cx) * 0x9E3779B1u ^ static_cast<std::uint32_t>(cy) * 0x85EBCA77u;
+                return (h ^ (h >> 15)) & bucketMask;
+            };
+            auto cellX = [invCell](Real x) { return static_cast<std::int32_t>(std::floor(x * invCell)); };
+
+            // 空間ハッシュを作る（計数ソート）
+            it.cellOf.resize(qty);
+            it.cellStart.assign(bucketQty + 1, 0);
+            for (size_t i = 0; i < qty; ++i) {
+                it.cellOf[i] = bucketOf(cellX(elements[i].pos.x), cellX(elements[i].pos.y));
+                ++it.cellStart[it.cellOf[i] + 1];
+            }
+            std::partial_sum(it.cellStart.begin(), it.cellStart.end(), it.cellStart.begin());
+
+            it.order.resize(qty);
+            it.sortedX.resize(qty);
+            it.sortedY.resize(qty);
+            it.impulse.resize(qty);
+            {
+                std::vector<size_t>& cursor = it.cellStart;  // 書き込みで各バケットの終端まで進み、後で1つずらして戻す
+                for (size_t i = 0; i < qty; ++i) {
+                    size_t dst = cursor[it.cellOf[i]]++;
+                    it.order[dst]   = i;
+                    it.sortedX[dst] = elements[i].pos.x;
+                    it.sortedY[dst] = elements[i].pos.y;
+                }
+                std::copy_backward(cursor.begin(), cursor.end() - 1, cursor.end());
+                cursor[0] = 0;
+            }
+
+            // 近傍の粒子から受ける力を求める（バケット順に区間分けして並列）
+            Real radiusPow = radius * radius;
+            Real invRadius = One / radius;
+            Real power     = it.power * timeScale / scale;
+            Real falloff   = it.falloff;
+            auto weightOf  = [falloff](Real w) -> Real {  // よく使う指数はpowを避ける
+                if (falloff == One) return w;
+                if (falloff == Real(2.0)) return w * w;
+                return std::pow(w, falloff);
+            };
+            parallelRanges(qty, [&](size_t begin, size_t end) {
+                for (size_t s = begin; s < end; ++s) {
+                    Real x = it.sortedX[s];
+                    Real y = it.sortedY[s];
+                    std::int32_t cx = cellX(x);
+                    std::int32_t cy = cellX(y);
+                    RealVec2 force(0.0, 0.0);
+                    size_t   neighborQty = 0;
+
+                    // 周囲3x3のセル。ハッシュが衝突して同じバケットになったものは1回だけ調べる
+                    std::uint32_t visited[9];
+                    int visitedQty = 0;
+                    for (int dy = -1; dy <= 1 && neighborQty < it.neighborLimit; ++dy) {
+                        for (int dx = -1; dx <= 1 && neighborQty < it.neighborLimit; ++dx) {
+                            std::uint32_t bucket = bucketOf(cx + dx, cy + dy);
+                            if (std::find(visited, visited + visitedQty, bucket) != visited + visitedQty) continue;
+                            visited[visitedQty++] = bucket;
+
+                            for (size_t n = it.cellStart[bucket], nEnd = it.cellStart[bucket + 1]; n < nEnd; ++n) {
+                                if (n == s) continue;
+                                Real vx = x - it.sortedX[n];
+                                Real vy = y - it.sortedY[n];
+                                Real distPow = vx * vx + vy * vy;
+                                if (distPow >= radiusPow) continue;  // 範囲外（ハッシュの衝突で混じった遠くの粒子も含む）
+
+                                Real dist   = std::sqrt(distPow);
+                                Real weight = One - dist * invRadius;
+                                if (dist < KotsubuMath::Epsilon) {
+                                    // 重なっている粒子は、組ごとに決まる向きで押し分ける（向きは逆）
+                                    Real rad = static_cast<Real>(std::min(s, n) * 2654435761u % 6283) * Real(0.001);
+                                    Real sign = (s < n) ? -One : One;
+                                    vx = math.cos(rad) * sign;
+                                    vy = math.sin(rad) * sign;
+                                    dist = One;
+                                }
+                                Real rate = weightOf(weight) / dist;
+                                force.x += vx * rate;
+                                force.y += vy * rate;
+                                if (++neighborQty >= it.neighborLimit) break;
+                            }
+                        }
+                    }
+                    it.impulse[it.order[s]] = force * power;
+                }
+            });
+
+            // 速度変化を、進行方向と速度に合成する（引力の成分はそのまま）
+            parallelRanges(qty, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) {
+                    RealVec2 dv = it.impulse[i];
+                    if (dv.x == Real(0.0) && dv.y == Real(0.0)) continue;
+                    auto& r = elements[i];
+                    RealVec2 move(std::cos(r.radian) * r.speed + dv.x, std::sin(r.radian) * r.speed + dv.y);
+                    r.radian = math.direction(move);
+                    r.speed  = math.length(move);
+                }
+            });
+        }
+
+        // 【内部メソッド】すべての障害物をスケーリング
+        void scalingObstacles(Real scale)
+        {
+            if (scale == One) return;  // 等倍なら帰る
+            Real rate = math.inverseNumber(scale);
+
+            for (auto& r : obstacleLines) {
+                r.startPos *= rate;
+                r.endPos   *= rate;
+            }
+            for (auto& r : obstacleRects) {
+                r.left   *= rate;
+                r.top    *= rate;
+                r.right  *= rate;
+                r.bottom *= rate;
+            }
+            for (auto& r : obstacleCircles) {
+                r.pos    *= rate;
+                r.radius *= rate;
+            }
+            for (auto& polygon : obstaclePolygons) {
+                for (auto& vertex : polygon) {
+                    vertex.x *= rate;
+                    vertex.y *= rate;
+                }
+            }
+            for (auto& polyline : obstaclePolylines) {
+                for (auto& vertex : polyline) {
+                    vertex.x *= rate;
+                    vertex.y *= rate;
+                }
+            }
+            for (auto& r : forceFields) {  // 力場の強さも、speedと同じくイメージのピクセルに直す（Dragは割合なのでそのまま）
+                r.left   *= rate;
+                r.top    *= rate;
+                r.right  *= rate;
+                r.bottom *= rate;
+                r.x      *= rate;
+                r.y      *= rate;
+                r.radius *= rate;
+                if (r.type != FieldType::Drag) {
+                    r.powerX *= rate;
+                    r.powerY *= rate;
+                }
+            }
+        }
+
+
+        // 【内部メソッド】衝突判定の準備（障害物ごとの判定順をランダムにずらす）
+        // ＜戻り値＞ 障害物が1つでも登録されていればtrue
+        bool beginCollision()
+        {
+            bool isExist = false;
+            isExist |= rotateObstacles(obstacleLines,     obstacleShift[size_t(ObstacleType::Line)]);
+            isExist |= rotateObstacles(obstacleRects,     obstacleShift[size_t(ObstacleType::Rect)]);
+            isExist |= rotateObstacles(obstacleCircles,   obstacleShift[size_t(ObstacleType::Circle)]);
+            isExist |= rotateObstacles(obstaclePolygons,  obstacleShift[size_t(ObstacleType::Polygon)]);
+            isExist |= rotateObstacles(obstaclePolylines, obstacleShift[size_t(ObstacleType::Polyline)]);
+            if (isExist) packObstacles();
+            return isExist;
+        }
+
+
+        // 【内部メソッド】線分と矩形を一括判定用に並べ直し、障害物の辺の向きを求めておく
+        // 並び順は障害物と同じ（添え字で元の障害物を参照できる）
+        void packObstacles()
+        {
+            packedLines.clear();
+            for (auto& line : obstacleLines)
+                packedLines.add(line);
+
+            packedRects.clear();
+            for (auto& rect : obstacleRects)
+                packedRects.add(rect);
+
+            // 多角形は辺の法線と距離にしておく（配列は使い回して再確保を避ける）
+            packedPolygons.resize(obstaclePolygons.size());
+            for (size_t i = 0; i < obstaclePolygons.size(); ++i)
+                packedPolygons[i].set(obstaclePolygons[i]);
+
+            lineDirections.resize(obstacleLines.size());
+            for (size_t i = 0; i < obstacleLines.size(); ++i)
+                lineDirections[i] = math.direction(obstacleLines[i].endPos - obstacleLines[i].startPos);
+
+            cacheEdgeDirections(obstaclePolygons,  polygonEdgeDirections);
+            cacheEdgeDirections(obstaclePolylines, polylineEdgeDirections);
+        }
+
+
+        void cacheEdgeDirections(const std::vector<std::vector<RealVec2>>& shapes, std::vector<std::vector<Real>>& directions)
+        {
+            directions.resize(shapes.size());
+            for (size_t i = 0; i < shapes.size(); ++i) {
+                directions[i].resize(shapes[i].size() - 1);
+                math.edgeDirections(shapes[i].data(), shapes[i].size(), directions[i].data());
+            }
+        }
+
+
+        // ＜引数＞
+        // shift --- ずらした量を加算する（添え字nの障害物は、登録順で「(n + shift) % 個数」番目）
+        template<typename T>
+        bool rotateObstacles(T& obstacles, size_t& shift)
+        {
+            if (obstacles.empty()) return false;
+            size_t n = Random(obstacles.size() - 1);
+            std::rotate(obstacles.begin(), obstacles.begin() + n, obstacles.end());
+            shift = (shift + n) % obstacles.size();
+            return true;
+        }
+
+
+        // 【内部メソッド】衝突の記録を空にし、障害物ごとの衝突回数を登録数に合わせる（updateの最初に呼ぶ）
+        // 配列は使い回すので、容量に達した後は確保しない
+        void beginCollisionEvents(Real scale)
+        {
+            worldScale = scale;
+            obstacleShift.fill(0);
+            collisionEvents.clear();
+            if (!isCountHits) return;
+            hitCounts[size_t(ObstacleType::Line)].assign(obstacleLines.size(), 0);
+            hitCounts[size_t(ObstacleType::Rect)].assign(obstacleRects.size(), 0);
+            hitCounts[size_t(ObstacleType::Circle)].assign(obstacleCircles.size(), 0);
+            hitCounts[size_t(ObstacleType::Polygon)].assign(obstaclePolygons.size(), 0);
+            hitCounts[size_t(ObstacleType::Polyline)].assign(obstaclePolylines.size(), 0);
+        }
+
+
+        // 【内部メソッド】衝突を記録（reverseDirectionの前に呼ぶ。移動量から速さと法線の向きを求める）
+        // ＜引数＞
+        // n                 --- 衝突判定の順（ずらした後）の添え字
+        // obstacleQty       --- その種類の障害物の数
+        // reflectionAxisRad --- 衝突面の角度
+        void recordCollision(const Element& elm, ObstacleType type, size_t n, size_t obstacleQty,
+                             Real reflectionAxisRad, Real timeScale)
+        {
+            if (collisionCapacity == 0) return;
+            size_t t  = static_cast<size_t>(type);
+            size_t id = (n + obstacleShift[t]) % obstacleQty;
+            if (isCountHits && id < hitCounts[t].size()) ++hitCounts[t][id];
+            if (collisionEvents.size() >= collisionCapacity) return;  // 上限を超えた分は捨てる（回数は数える）
+
+            RealVec2 move = elm.pos - elm.oldPos;
+            Real nx = -math.sin(reflectionAxisRad);
+            Real ny =  math.cos(reflectionAxisRad);
+            if (nx * move.x + ny * move.y > Real(0.0)) {
+                nx = -nx;
+                ny = -ny;
+            }
+
+            CollisionEvent e;
+            e.pos    = Vec2(elm.pos.x * worldScale, elm.pos.y * worldScale);
+            e.normal = Vec2(nx, ny);
+            e.speed  = math.length(move) * timeScale * worldScale;
+            e.type   = type;
+            e.id     = static_cast<uint32>(id);
+            collisionEvents.emplace_back(e);
+        }
+
+
+        // 【内部メソッド】休止中の粒子を前に集める（静止した粒子を、動く粒子の先頭と入れかえる）
+        // 動く粒子の並び順は変わる
+        template<typename T, typename S>
+        void gatherSleepers(T& elements, S&& isResting)
+        {
+            for (size_t i = sleepQty; i < elements.size(); ++i) {
+                if (!isResting(elements[i])) continue;
+                if (i != sleepQty) std::swap(elements[i], elements[sleepQty]);
+                ++sleepQty;
+            }
+        }
+
+
+        // 【内部メソッド】登録された障害物の署名（FNV-1a）。前回と違えば、障害物が変わったとみなす
+        std::uint64_t signObstacles() const
+        {
+            std::uint64_t hash = 14695981039346656037ull;
+            auto mix = [&hash](const void* data, size_t bytes) {
+                auto p = static_cast<const unsigned char*>(data);
+                for (size_t i = 0; i < bytes; ++i) hash = (hash ^ p[i]) * 1099511628211ull;
+                hash = (hash ^ bytes) * 1099511628211ull;  // 区切り（個数の違いも区別する）
+            };
+            mix(obstacleLines.data(),   obstacleLines.size()   * sizeof(KotsubuMath::Line));
+            mix(obstacleRects.data(),   obstacleRects.size()   * sizeof(KotsubuMath::Rect));
+            mix(obstacleCircles.data(), obstacleCircles.size() * sizeof(KotsubuMath::Circle));
+            for (auto& polygon : obstaclePolygons)   mix(polygon.data(),  polygon.size()  * sizeof(RealVec2));
+            for (auto& polyline : obstaclePolylines) mix(polyline.data(), polyline.size() * sizeof(RealVec2));
+            return hash;
+        }
+
+
+        // 【内部メソッド】今回のupdateで休止できるかを決める（updateの最初、障害物を縮める前に呼ぶ）
+        // ＜引数＞
+        // isQuiet --- 粒子の設定に、静止した粒子を動かすもの（正の加速）が無いかどうか
+        // 力場、乱流、相互作用、サブエミッタ、障害物の変化のどれかがあれば、休止中の粒子をすべて起こす
+        void beginSleep(bool isQuiet, size_t elementQty)
+        {
+            std::uint64_t signature = signObstacles();
+            canSleep = isSleep && isQuiet && forceFields.empty() && !flowField.enable && !interaction.enable &&
+                       subEmitters.empty() && signature == obstacleSignature;
+            obstacleSignature = signature;
+            sleepQty = canSleep ? std::min(sleepQty, elementQty) : 0;
+        }
+
+
+        // 【内部メソッド】衝突の記録を有効にする
+        void setupCollisionEvents(size_t capacity, bool countHits)
+        {
+            collisionCapacity = capacity;
+            isCountHits       = countHits && capacity > 0;
+            collisionEvents.clear();
+            collisionEvents.reserve(capacity);
+            if (!isCountHits)
+                for (auto& counts : hitCounts) counts.clear();
+        }
+
+
+        // 【内部メソッド】衝突判定の後始末（障害物と力場はすべて破棄）
+        void endCollision()
+        {
+            obstacleLines.clear();
+            obstacleRects.clear();
+            obstacleCircles.clear();
+            obstaclePolygons.clear();
+            obstaclePolylines.clear();
+            forceFields.clear();
+        }
+
+
+        // 【内部メソッド】力場を1個追加（引数は公開メソッドのままのdoubleで受け、格納時にRealにする）
+        void registForceField(FieldType type, double left, double top, double right, double bottom,
+                              Vec2 pos, double radius, double powerX, double powerY, double falloff)
+        {
+            ForceField f;
+            f.type    = type;
+            f.left    = static_cast<Real>(std::min(left, right));
+            f.top     = static_cast<Real>(std::min(top, bottom));
+            f.right   = static_cast<Real>(std::max(left, right));
+            f.bottom  = static_cast<Real>(std::max(top, bottom));
+            f.x       = static_cast<Real>(pos.x);
+            f.y       = static_cast<Real>(pos.y);
+            f.radius  = static_cast<Real>(radius);
+            f.powerX  = static_cast<Real>(powerX);
+            f.powerY  = static_cast<Real>(powerY);
+            f.falloff = static_cast<Real>(std::max(falloff, 0.0));
+            forceFields.emplace_back(f);
+        }
+
+
+        // 【内部メソッド】粒子1個に対して、すべての障害物との衝突判定を行う
+        void collideElement(Element& elm, Real timeScale)
+        {
+            collisionLines(elm, timeScale);
+            collisionRects(elm, timeScale);
+            collisionCircles(elm, timeScale);
+            collisionPolygons(elm, timeScale);
+            if (elm.enable) collisionPolylines(elm, timeScale);
+        }
+
+
+        // 【内部メソッド】線分との衝突判定
+        void collisionLines(Element& elm, Real timeScale)
+        {
+            int n = math.hit.lineOnLines(elm.oldPos, elm.pos, packedLines);
+            if (n >= 0) {
+                recordCollision(elm, ObstacleType::Line, n, obstacleLines.size(), lineDirections[n], timeScale);
+                reverseDirection(elm, lineDirections[n], timeScale);
+                elm.pos = elm.oldPos;
+                elm.fadeout = true;
+            }
+        }
+
+
+        // 【内部メソッド】矩形との衝突判定
+        void collisionRects(Element& elm, Real timeScale)
+        {
+            int n = math.hit.pointOnBoxes(elm.pos, packedRects);
+            if (n >= 0) {
+                auto& rect = obstacleRects[n];
+                if (math.hit.lineOnHorizontal(elm.oldPos.y, elm.pos.y, rect.top) ||
+                    math.hit.lineOnHorizontal(elm.oldPos.y, elm.pos.y, rect.bottom)) {
+                    recordCollision(elm, ObstacleType::Rect, n, obstacleRects.size(), 0.0, timeScale);
+                    reverseDirection(elm, 0.0, timeScale);
+                }
+                else {
+                    recordCollision(elm, ObstacleType::Rect, n, obstacleRects.size(), math.RightAngle, timeScale);
+                    reverseDirection(elm, math.RightAngle, timeScale);
+                }
+                elm.pos = elm.oldPos;
+                elm.fadeout = true;
+            }
+        }
+
+
+        // 【内部メソッド】円との衝突判定
+        void collisionCircles(Element& elm, Real timeScale)
+        {
+            for (size_t n = 0; n < obstacleCircles.size(); ++n) {
+                auto& circle = obstacleCircles[n];
+                Real radiusPow = circle.radius * circle.radius;
+                if (math.distancePow(elm.pos, circle.pos) < radiusPow) {
+                    Real axisRad = math.direction(circle.pos - elm.pos) + math.RightAngle;
+                    recordCollision(elm, ObstacleType::Circle, n, obstacleCircles.size(), axisRad, timeScale);
+                    reverseDirection(elm, axisRad, timeScale);
+                    elm.pos = elm.oldPos;
+                    elm.fadeout = true;
+                    break;
+                }
+            }
+        }
+
+
+        // 【内部メソッド】凸多角形（全ての内角は180°以下）との衝突判定
+        // 処理速度優先のため、細長い部分は「壁抜け」が発生する
+        // ＜引数＞ vertices
+        // ・多角形の各頂点の座標を、vector<Vec2>に「時計回り」の順に格納したもの
+        void collisionPolygons(Element& elm, Real timeScale)
+        {
+            for (size_t n = 0; n < obstaclePolygons.size(); ++n) {
+                auto& vertices = obstaclePolygons[n];
+                if (math.hit.pointOnPolygon(elm.pos, packedPolygons[n])) {
+                    // どの辺と交差したかを調べて跳ね返す
+                    bool isIntersect = false;
+                    for (int i = 0, edgeQty = vertices.size() - 1; i < edgeQty; ++i) {
+                        KotsubuMath::Line edge(vertices[i], vertices[i + 1]);
+                        if (math.hit.lineOnLine(edge.startPos, edge.endPos, elm.oldPos, elm.pos)) {
+                            recordCollision(elm, ObstacleType::Polygon, n, obstaclePolygons.size(), polygonEdgeDirections[n][i], timeScale);
+                            reverseDirection(elm, polygonEdgeDirections[n][i], timeScale);
+                            elm.pos = elm.oldPos;
+                            elm.fadeout = true;
+                            isIntersect = true;
+                            break;
+                        }
+                    }
+                    // 交差している辺が無い（図形の内部）なら、図形の外に出ない限り
+                    // 上の処理が行われ続けて重くなるので、粒子を消す
+                    elm.enable = isIntersect;
+                    break;
+                }
+            }
+        }
+
+
+        // 【内部メソッド】ポリライン（数珠繋ぎの線分）との衝突判定
+        void collisionPolylines(Element& elm, Real timeScale)
+        {
+            for (size_t n = 0; n < obstaclePolylines.size(); ++n) {
+                auto& vertices = obstaclePolylines[n];
+                bool isIntersect = false;
+                for (int i = 0, edgeQty = vertices.size() - 1; i < edgeQty; ++i) {
+                    KotsubuMath::Line edge(vertices[i], vertices[i + 1]);
+                    if (math.hit.lineOnLine(edge.startPos, edge.endPos, elm.oldPos, elm.pos)) {
+                        recordCollision(elm, ObstacleType::Polyline, n, obstaclePolylines.size(), polylineEdgeDirections[n][i], timeScale);
+                        reverseDirection(elm, polylineEdgeDirections[n][i], timeScale);
+                        elm.pos = elm.oldPos;
+                        elm.fadeout = true;
+                        isIntersect = true;
+                        break;
+                    }
+                }
+                if (isIntersect) break;
+            }
+        }
+
+        // 【内部メソッド】粒子の進行方向を反転（位置修正なし）
+        // ＜引数＞
+        // reflectionAxisRad --- 反射軸の角度
+        void reverseDirection(Element& element, Real reflectionAxisRad, Real timeScale)
+        {
+            RealVec2 move = element.pos - element.oldPos;
+            
+            // 進行方向を反転
+            // このプログラムの移動処理は、element.radianとgravityRadの
+            // 「2系統」を合算して、実際の「見た目の方向」となる。
+            // よって、「見た目の方向」を反射させるためには、1系統だけを反射
+            // しても意味はなく、「実際に移動した量、および角度」を元に算出する。
+            element.radian = math.reflection(math.direction(move), reflectionAxisRad);
+
+            // 速度を「移動距離」とし、力を減衰させる。（直前までの引力成分も含まれる）
+            element.speed = math.length(move) * timeScale * ReflectionPowerRate;
+
+            // 引力をリセット（引力成分はelement.speedに引き継がれている）
+            element.gravity = 0.0;
+
+            ++hitCount;
+        }
+
+
+        //// 【内部メソッド】衝突面を通り過ぎた粒子位置を修正（厳密。負荷高め）
+        //// ＜引数＞
+        //// lineStartPos --- 衝突面（線分）の始点
+        //// lineNormal   --- 衝突面（線分）の正規化ベクトル
+        //void fixCollisionOverrun(Element& element, Vec2 lineStartPos, Vec2 lineNormal)
+        //{
+        //    Vec2 normal = math.normalize(element.pos - element.oldPos);
+        //    Vec2 hypot  = element.pos - lineStartPos;
+        //    double len  = abs(math.outerProduct(hypot, lineNormal));
+
+        //    element.pos -= normal * len * 2.0;
+        //}
+
+
+        //// 【内部メソッド】衝突面を通り過ぎた粒子位置を修正（軽量版）
+        //// 次の移動時に衝突ループさせない最低限の修正のため、潜り込みは発生する。
+        //// もっと軽量、かつ潜り込まないようにするには、単純に pos = oldPos とすればよい
+        //void fixCollisionOverrunLite(Element& element)
+        //{
+        //    Vec2 v(element.pos - element.oldPos);
+        //    element.pos = element.oldPos + v * ReflectionPowerRate;
+        //}
+
+
+
+    public:
+        // 【メソッド】衝突判定の図形を登録（線分）
+        // 順次登録可能。次回update時に反映＆すべて破棄
+        void registObstacleLine(Vec2 lineStartPos, Vec2 lineEndPos)
+        {
+            obstacleLines.emplace_back(KotsubuMath::Line(lineStartPos, lineEndPos));
+        }
+
+
+        // 【メソッド】衝突判定の図形を登録（矩形）
+        // 順次登録可能。次回update時に反映＆すべて破棄
+        void registObstacleRect(double left, double top, double right, double bottom)
+        {
+            obstacleRects.emplace_back(toRealRect(left, top, right, bottom));
+        }
+
+
+        // 【メソッド】衝突判定の図形を登録（円）
+        // 順次登録可能。次回update時に反映＆すべて破棄
+        void registObstacleCircle(Vec2 pos, double radius)
+        {
+            obstacleCircles.emplace_back(KotsubuMath::Circle(pos, static_cast<Real>(radius)));
+        }
+
+
+        // 【メソッド】衝突判定の図形を登録（凸多角形。全ての内角は180°以下）
+        // 順次登録可能。次回update時に反映＆すべて破棄。
+        // 処理速度優先のため、細長い部分は「壁抜け」が発生する。問題がある場合は、
+        // 図形をそこだけ「線分」で構成するとよい（registObstacleLineは正確）
+        // ＜引数＞ vertices
+        // ・各頂点の座標を、vector<Vec2>に「時計回り」の順に格納したもの
+        // ・凹型にならないよう注意する（動作不定。どうしても凹型にしたい場合は、凸型に分けて複数登録する）
+        // ・最後の頂点と最初の頂点は自動的に閉じられる
+        void registObstaclePolygon(const std::vector<Vec2>& vertices)
+        {
+            if (vertices.size() < 3) return;  // 頂点が3個未満なら登録しない
+            obstaclePolygons.emplace_back(vertices.begin(), vertices.end());
+            obstaclePolygons.back().emplace_back(vertices[0]);  // 図形を閉じるために「最初の頂点」を追加
+        }
+
+
+        // 【メソッド】衝突判定の図形を登録（ポリライン。数珠繋ぎの線分）
+        // 順次登録可能。次回update時に反映＆すべて破棄。
+        // ＜引数＞ vertices
+        // ・各頂点の座標を、順番にvector<Vec2>に格納したもの
+        void registObstaclePolyline(const std::vector<Vec2>& vertices)
+        {
+            if (vertices.size() < 2) return;  // 頂点が2個未満なら登録しない
+            obstaclePolylines.emplace_back(vertices.begin(), vertices.end());
+        }
+
+
+        // 【メソッド】力場を登録（引き寄せ。powerが負なら押しのける）
+        // 順次登録可能。次回update時に反映＆すべて破棄（障害物と同じ）
+        // ＜引数＞
+        // radius  --- 影響半径。外の粒子は計算しない
+        // power   --- 中心での強さ（60FPSの1フレームあたりの速度変化）。中心から離れるほど弱まる
+        // falloff --- 減衰の指数。強さは「power * (1 - 距離 / radius)^falloff」
+        void registForceAttractor(Vec2 pos, double radius, double power, double falloff = 1.0)
+        {
+            if (radius <= 0.0) return;
+            registForceField(FieldType::Attractor, pos.x - radius, pos.y - radius, pos.x + radius, pos.y + radius,
+                             pos, radius, power, 0.0, falloff);
+        }
+
+
+        // 【メソッド】力場を登録（渦。powerが正なら時計回り、負なら反時計回り）
+        // 順次登録可能。次回update時に反映＆すべて破棄。引数はregistForceAttractorと同じ
+        void registForceVortex(Vec2 pos, double radius, double power, double falloff = 1.0)
+        {
+            if (radius <= 0.0) return;
+            registForceField(FieldType::Vortex, pos.x - radius, pos.y - radius, pos.x + radius, pos.y + radius,
+                             pos, radius, power, 0.0, falloff);
+        }
+
+
+        // 【メソッド】力場を登録（風。矩形の中の粒子を、forceの向きと強さで押し続ける）
+        // 順次登録可能。次回update時に反映＆すべて破棄
+        void registForceWind(double left, double top, double right, double bottom, Vec2 force)
+        {
+            registForceField(FieldType::Wind, left, top, right, bottom, Vec2(0, 0), 0.0, force.x, force.y, 1.0);
+        }
+
+
+        // 【メソッド】力場を登録（空気抵抗。60FPSの1フレームごとに、速度のrateの割合を失う。0.0 ～ 1.0）
+        // 順次登録可能。次回update時に反映＆すべて破棄。矩形を省略すると全体
+        void registForceDrag(double rate)
+        {
+            Real far = std::numeric_limits<Real>::max();
+            registForceDrag(rate, -far, -far, far, far);
+        }
+
+        void registForceDrag(double rate, double left, double top, double right, double bottom)
+        {
+            rate = std::clamp(rate, 0.0, 1.0);
+            registForceField(FieldType::Drag, left, top, right, bottom, Vec2(0, 0), 0.0, rate, 0.0, 1.0);
+        }
+
+
+        // 【メソッド】直前のupdateでの衝突の記録（recordCollisionsで有効にした場合のみ）
+        // 次のupdateまで有効。容量を超えた衝突は含まれない
+        ReadSpan<CollisionEvent> collisions() const
+        {
+            return { collisionEvents.data(), collisionEvents.size() };
+        }
+
+
+        // 【メソッド】直前のupdateでの、障害物ごとの衝突回数（登録順。recordCollisionsでcountHitsを有効にした場合のみ）
+        // 記録の容量を超えた衝突も数える
+        ReadSpan<uint32> collisionCounts(ObstacleType type) const
+        {
+            auto& counts = hitCounts[static_cast<size_t>(type)];
+            return { counts.data(), counts.size() };
+        }
+    };
+
+
+
+
+    /////////////////////////////////////////////////////////////////////////////////////
+    // 【クラス】点系パーティクルの共有キャンバス
+    // 複数のDot系インスタンスが、1枚のイメージに点を打つ。クリアとテクスチャの更新は1フレームに1回だけになる。
+    // 使い方） canvas.clear();  spark1.draw();  spark2.draw();  canvas.draw();
+    // 登録したインスタンス（Particle::canvas）のdotScaleは、キャンバスの拡大率に従う。
+    // キャンバスは、登録したインスタンスより長く生きていること
+    //
+    class DotCanvas
+    {
+    private:
+        // 【内部フィールド】
+        Real           scaleRate;     // ドットの拡大率
+        SamplerState   samplerState;
+        BlendState     blendState;
+        DynamicTexture tex;
+        Image          img;
+        Image          blankImg;      // 容量（ウィンドウが小さくなっても作り直さない）
+        Size           viewSize;      // 使う範囲（ウィンドウの大きさ）
+        Works::DirtyRegion dirty;     // 点を打った範囲
+        bool           viewing;       // カメラの視野を指定したかどうか
+        RealVec2       origin;        // イメージの左上（イメージの座標）
+
+    public:
+        // 【コンストラクタ】
+        DotCanvas(double scale = 3.0) :
+            scaleRate(0.0), samplerState(s3d::SamplerState::ClampNearest), blendState(s3d::BlendState::Additive),
+            viewSize(0, 0), viewing(false), origin(0.0, 0.0)
+        {
+            dotScale(scale);
+        }
+
+
+        // 【セッタ】メソッドチェーン方式
+        // ドットの拡大率。1.0（等倍） ～ 8.0
+        DotCanvas& dotScale(double scale)
+        {
+            if (scale < 1.0) scale = 1.0;
+            if (scale > 8.0) scale = 8.0;
+
+            if (static_cast<Real>(scale) != scaleRate) {
+                scaleRate = static_cast<Real>(scale);
+                Works::fitCanvas(blankImg, tex, scaleRate, viewSize, true);  // 新しいサイズのブランクイメージを作る
+            }
+
+            return *this;
+        }
+
+        // スムージング
+        DotCanvas& smoothing(bool isSmooth)
+        {
+            samplerState = isSmooth ? s3d::SamplerState::ClampLinear : s3d::SamplerState::ClampNearest;
+            return *this;
+        }
+
+        // テクスチャを描画するときのブレンド
+        DotCanvas& blend(s3d::BlendState state) { blendState = state; return *this; }
+
+        // カメラの視野。イメージを視野の左上（1ドット単位）に合わせて置く
+        DotCanvas& cameraView(const RectF& view)
+        {
+            viewing = true;
+            origin  = RealVec2(std::floor(static_cast<Real>(view.leftX()) / scaleRate), std::floor(static_cast<Real>(view.topY()) / scaleRate));
+            return *this;
+        }
+
+        // カメラの視野を解除
+        DotCanvas& clearCameraView()
+        {
+            viewing = false;
+            origin  = RealVec2(0.0, 0.0);
+            return *this;
+        }
+
+
+        // 【メソッド】イメージをクリア（1フレームに1回、インスタンスのdrawより先に呼ぶ）
+        // クリアするのは、前回点を打った範囲だけ。ウィンドウの大きさが変わっていれば、ここで合わせる
+        void clear()
+        {
+            Works::fitCanvas(blankImg, tex, scaleRate, viewSize, false);
+            Works::clearDirty(img, blankImg, dirty);
+        }
+
+
+        // 【メソッド】ドロー（インスタンスのdrawの後に呼ぶ）。テクスチャの更新はここで1回だけ行う
+        void draw()
+        {
+            Budget::Meter meter;
+            if (img.isEmpty()) return;
+            Works::uploadDirty(tex, img, dirty);  // 点を打った範囲だけを転送する
+            s3d::RenderStateBlock2D tmp(blendState, samplerState);
+            tex(0, 0, viewSize.x, viewSize.y).scaled(scaleRate)
+                .draw(origin.x * scaleRate - Works::WorldMargin, origin.y * scaleRate - Works::WorldMargin);
+        }
+
+
+        // 【ゲッタ】登録したインスタンスが使う
+        Real            scale()       const { return scaleRate; }  // ドットの拡大率
+        const RealVec2& topLeft()     const { return origin; }     // イメージの左上（イメージの座標）
+        const Size&     size()        const { return viewSize; }   // 使う範囲（点を打つ範囲）
+        Size            capacity()    const { return Size(blankImg.width(), blankImg.height()); }  // 粒子が生きられる範囲
+        Image&          image()             { return img; }        // 点を打つイメージ
+        Works::DirtyRegion& dirtyRegion()   { return dirty; }      // 点を打った範囲
+    };
+
+
+
+
+
+    /////////////////////////////////////////////////////////////////////////////////////
+    // 【列挙型】パーティクルの機能（Featuresで組み合わせる）
+    //
+    enum class FadeMode
+    {
+        Timed,     // 生存時間がfadeoutTimeを超えたらフェードアウト（既定）
+        AccelOnly  // アルファはaccelColorのみで変化（衝突時のフェードアウトは行う）
+    };
+
+    enum class BoundsMode
+    {
+        Window,  // ウィンドウ＋サイズ＋余白の外で無効（座標はウィンドウ）
+        Image    // イメージの外で無効（座標はdotScaleで縮小したイメージ。Renderer::Dot専用）
+    };
+
+    enum class Renderer
+    {
+        Circle,  // s3d::Circle
+        Dot,     // 動的テクスチャ（イメージに点を打つ）
+        Star     // Shape2D::Star
+    };
+
+
+
+
+
+    /////////////////////////////////////////////////////////////////////////////////////
+    // 【構造体】パーティクルの機能（ポリシー）
+    // Particleのテンプレート引数。使わない機能は、粒子のメンバと経過処理ごとコンパイルされない
+    // ＜引数＞
+    // SizeOverTime --- サイズとその変化（size、accelSize）
+    // Rotation     --- 回転（rotate）
+    // Gravity      --- 引力（gravity、gravityAngle）
+    // LifeCurves   --- 生存期間に対する曲線（lifeSpan、sizeOverLife、colorOverLife、speedOverLife）。
+    //                  色とサイズはaccelColor、accelSizeの累積の代わりに、表を1回引いて決める
+    //
+    template<bool SizeOverTime, bool Rotation, bool Gravity, FadeMode Fade, BoundsMode Bounds, Renderer Draw,
+             bool LifeCurves = false>
+    struct Features
+    {
+        static constexpr bool       sizeOverTime = SizeOverTime;
+        static constexpr bool       rotation     = Rotation;
+        static constexpr bool       gravity      = Gravity;
+        static constexpr FadeMode   fade         = Fade;
+        static constexpr BoundsMode bounds       = Bounds;
+        static constexpr Renderer   renderer     = Draw;
+        static constexpr bool       lifeCurves   = LifeCurves;
+        static_assert(Bounds != BoundsMode::Image || Draw == Renderer::Dot, "BoundsMode::Image requires Renderer::Dot");
+    };
+
+    using CircleFeatures = Features<true,  false, true, FadeMode::Timed, BoundsMode::Window, Renderer::Circle>;
+    using DotFeatures    = Features<false, false, true, FadeMode::Timed, BoundsMode::Image,  Renderer::Dot>;
+    using StarFeatures   = Features<true,  true,  true, FadeMode::Timed, BoundsMode::Window, Renderer::Star>;
+
+
+
+
+
+    /////////////////////////////////////////////////////////////////////////////////////
+    // 【テンプレートクラス】パーティクル本体
+    // Circle、Dot、Starはこれの別名。機能の組み合わせを変えれば、専用の軽量なパーティクルが作れる
+    // 例） using Spark = Particle<Features<false, false, false, FadeMode::AccelOnly, BoundsMode::Image, Renderer::Dot>>;
+    //     using Ember = Particle<Features<true, false, true, FadeMode::Timed, BoundsMode::Window, Renderer::Circle, true>>;
+    //
+    template<typename P>
+    class Particle : public Works
+    {
+        friend class Manager;
+
+    protected:
+        // クラス内部で使用する構造体
+        template<typename Base>
+        struct WithSize : public Base
+        {
+            Real size;
+            WithSize() : size(20.0)
+            {}
+            WithSize(RealVec2 _pos, Real _radian, Real _speed, RealColor _color) :
+                Base(_pos, _radian, _speed, _color), size(20.0)
+            {}
+        };
+
+
+        template<typename Base>
+        struct WithRotation : public Base
+        {
+            Real rotateRad;
+            Real rotateSpeed;
+            WithRotation() : rotateRad(0.0), rotateSpeed(0.0)
+            {}
+            WithRotation(RealVec2 _pos, Real _radian, Real _speed, RealColor _color) :
+                Base(_pos, _radian, _speed, _color), rotateRad(0.0), rotateSpeed(0.0)
+            {}
+        };
+
+
+        template<typename Base>
+        struct WithLife : public Base
+        {
+            Real baseSize;  // 生成時のサイズ（sizeOverLifeの倍率を掛ける元）
+            Real fade;      // フェードアウトの残り（colorOverLifeのアルファに掛ける）
+            WithLife() : baseSize(0.0), fade(1.0)
+            {}
+            WithLife(RealVec2 _pos, Real _radian, Real _speed, RealColor _color) :
+                Base(_pos, _radian, _speed, _color), baseSize(0.0), fade(1.0)
+            {}
+        };
+
+
+        using SizedElement    = std::conditional_t<P::sizeOverTime, WithSize<Element>, Element>;
+        using RotatedElement  = std::conditional_t<P::rotation, WithRotation<SizedElement>, SizedElement>;
+        using ParticleElement = std::conditional_t<P::lifeCurves, WithLife<RotatedElement>, RotatedElement>;
+
+
+        // 【内部定数】生存期間の曲線の表の要素数（経過率0.0 ～ 1.0を等分）
+        static constexpr size_t LifeCurveResolution = 64;
+
+
+        // LifeCurvesで使用する表（経過率で引く）
+        struct LifeCurveProperty
+        {
+            Real invLifeSpan;  // 生存期間（秒）の逆数
+            bool hasLifeColor; // colorOverLifeが設定されているかどうか
+            std::array<Real,      LifeCurveResolution> sizeRate;   // サイズの倍率
+            std::array<Real,      LifeCurveResolution> speedRate;  // 速度の倍率
+            std::array<RealColor, LifeCurveResolution> lifeColor;  // 色
+            LifeCurveProperty() : invLifeSpan(0.5), hasLifeColor(false)
+            {
+                sizeRate.fill(1.0);
+                speedRate.fill(1.0);
+                lifeColor.fill(RealColor(1.0, 1.0, 1.0, 1.0));
+            }
+        };
+
+        struct NoLifeCurveProperty
+        {};
+
+
+        // Renderer::Dotで使用するイメージ
+        struct ImageProperty
+        {
+            Real           dotScale;
+            SamplerState   samplerState;
+            DynamicTexture tex;
+            Image          img;
+            Image          blankImg;  // 容量（ウィンドウが小さくなっても作り直さない）
+            DotCanvas*     canvas;    // 共有キャンバス（無ければ自分のイメージに点を打つ）
+            DirtyRegion    dirty;     // 点を打った範囲
+            bool           isSubPixel;  // 点を周囲の4ドットに分けて打つ
+            Size           viewSize;  // 使う範囲（点を打つ範囲）
+            Size           liveSize;  // 粒子が生きられる範囲（容量。アップデートの前に写す）
+            RealVec2       liveOrigin;  // 粒子が生きられる範囲の左上（イメージの座標。アップデートの前に写す）
+            ImageProperty() : dotScale(0.0), samplerState(s3d::SamplerState::ClampNearest), canvas(nullptr), isSubPixel(false),
+                viewSize(0, 0), liveSize(0, 0), liveOrigin(0.0, 0.0)
+            {}
+        };
+
+        struct NoImageProperty
+        {};
+
+
+        struct ParticleProperty : public Property, public ParticleElement,
+            public std::conditional_t<P::renderer == Renderer::Dot, ImageProperty, NoImageProperty>,
+            public std::conditional_t<P::lifeCurves, LifeCurveProperty, NoLifeCurveProperty>
+        {
+            Real accelSize;
+            ParticleProperty() : accelSize(Real(-0.01))
+            {}
+        };
+
+
+        // 【内部定数】コンストラクタの既定の予約数
+        static constexpr size_t DefaultReserve = (P::renderer == Renderer::Dot)  ? 10000 :
+                                                 (P::renderer == Renderer::Star) ? 2000 : 3000;
+
+
+        // 【フィールド】
+        ParticleProperty property;
+
+
+        // 【内部メソッド】キー（経過率, 値）を折れ線でつなぎ、表に焼き込む
+        // 表の要素iは、区間の中央（(i + 0.5) / 要素数）の値。最初と最後のキーの外側は、端の値のまま
+        template<typename V, typename K, size_t N>
+        static void bakeLifeCurve(const std::vector<std::pair<double, K>>& keys, std::array<V, N>& table)
+        {
+            if (keys.empty()) return;
+            std::vector<std::pair<double, K>> sorted(keys);
+            std::stable_sort(sorted.begin(), sorted.end(),
+                [](const std::pair<double, K>& a, const std::pair<double, K>& b) { return a.first < b.first; });
+
+            size_t n = 0;
+            for (size_t i = 0; i < N; ++i) {
+                double age = (i + 0.5) / N;
+                while (n < sorted.size() && sorted[n].first <= age) ++n;
+                if (n == 0) {
+                    table[i] = V(sorted.front().second);
+                }
+                else if (n == sorted.size()) {
+                    table[i] = V(sorted.back().second);
+                }
+                else {
+                    auto& a = sorted[n - 1];
+                    auto& b = sorted[n];
+                    double t = (age - a.first) / (b.first - a.first);
+                    table[i] = V(lerpLifeKey(a.second, b.second, t));
+                }
+            }
+        }
+
+        static double lerpLifeKey(double a, double b, double t) { return a + (b - a) * t; }
+
+        static ColorF lerpLifeKey(const ColorF& a, const ColorF& b, double t)  // ColorFの演算はアルファが対象外なので成分ごとに
+        {
+            return ColorF(a.r + (b.r - a.r) * t, a.g + (b.g - a.g) * t, a.b + (b.b - a.b) * t, a.a + (b.a - a.a) * t);
+        }
+
+
+
+        // 【内部フィールド】もう一方のバッファ。非同期アップデート中は、開始時の粒子を持ち、描画に使う
+        // （beginUpdateでelementsと入れかえる。中身の複製は別スレッドが行う）
+        std::vector<ParticleElement> snapshot;
+
+        // 【内部メソッド】描画する粒子（非同期アップデート中は、開始時の粒子）
+        const std::vector<ParticleElement>& shownElements() const
+        {
+            return async.running ? snapshot : elements;
+        }
+
+
+
+    public:
+        // 【フィールド】
+        // 非同期アップデート中（beginUpdate ～ endUpdate）は、別スレッドが書きかえている
+        std::vector<ParticleElement> elements;
+
+
+        // 【コンストラクタ】
+        Particle(size_t reserve = DefaultReserve)
+        {
+            elements.reserve(reserve);
+            if constexpr (P::renderer == Renderer::Star) {
+                property.accelSize    = Real(1.3);
+                property.gravityPower = 0.0;
+            }
+            if constexpr (P::renderer == Renderer::Dot)
+                dotScale(3.0);
+        }
+
+
+        // 【デストラクタ】非同期アップデート中なら、終わるのを待つ（粒子が破棄される前に）
+        ~Particle()
+        {
+            endUpdate();
+        }
+
+
+        // 【セッタ】各初期パラメータ。メソッドチェーン方式
+        Particle& pos(         Vec2   pos)    { property.pos          = pos;                                           return *this; }
+        Particle& speed(       double speed)  { property.speed        = fixSpeed(static_cast<Real>(speed));            return *this; }
+        Particle& color(       ColorF color)  { property.color        = color;                                         return *this; }
+        Particle& angle(       double degree) { property.radian       = math.toRadian(static_cast<Real>(degree));      return *this; }
+        Particle& angleRange(  double degree) { property.radianRange  = math.toRadianRange(static_cast<Real>(degree)); return *this; }
+        Particle& accelSpeed(  double speed)  { property.accelSpeed   = static_cast<Real>(speed);                      return *this; }
+        Particle& accelColor(  ColorF color)  { property.accelColor   = color;                                         return *this; }
+        Particle& random(      double power)  { property.randPow      = fixRandomPower(static_cast<Real>(power));      return *this; }
+        Particle& blendState(s3d::BlendState state) { property.blendState = state; return *this; }
+
+        // 機能（Features）が有効なときだけ使えるセッタ
+        Particle& size(double size)
+        {
+            static_assert(P::sizeOverTime, "size requires Features::sizeOverTime");
+            property.size = fixSize(static_cast<Real>(size));
+            return *this;
+        }
+
+        Particle& accelSize(double size)
+        {
+            static_assert(P::sizeOverTime, "accelSize requires Features::sizeOverTime");
+            property.accelSize = static_cast<Real>(size);
+            return *this;
+        }
+
+        Particle& gravity(double power)
+        {
+            static_assert(P::gravity, "gravity requires Features::gravity");
+            property.gravityPower = fixGravityPower(static_cast<Real>(power));
+            return *this;
+        }
+
+        Particle& gravityAngle(double degree)
+        {
+            static_assert(P::gravity, "gravityAngle requires Features::gravity");
+            property.gravityRad = math.toRadian(static_cast<Real>(degree));
+            return *this;
+        }
+
+        Particle& rotate(double speed)
+        {
+            static_assert(P::rotation, "rotate requires Features::rotation");
+            property.rotateSpeed = static_cast<Real>(speed);
+            return *this;
+        }
+
+        // 生存期間（秒）。粒子はこれを過ぎると消え、各曲線はこの期間を0.0 ～ 1.0として引く
+        Particle& lifeSpan(double sec)
+        {
+            static_assert(P::lifeCurves, "lifeSpan requires Features::lifeCurves");
+            property.invLifeSpan = static_cast<Real>(1.0 / std::max(sec, 0.001));
+            return *this;
+        }
+
+        // サイズの曲線。keysは「経過率（0.0 ～ 1.0）と、生成時のサイズに掛ける倍率」の組。例） {{0, 0.2}, {0.3, 1}, {1, 0}}
+        Particle& sizeOverLife(const std::vector<std::pair<double, double>>& keys)
+        {
+            static_assert(P::lifeCurves && P::sizeOverTime, "sizeOverLife requires Features::lifeCurves and sizeOverTime");
+            property.sizeRate.fill(1.0);
+            bakeLifeCurve(keys, property.sizeRate);
+            return *this;
+        }
+
+        // 速度の曲線。keysは「経過率と、移動量に掛ける倍率」の組
+        Particle& speedOverLife(const std::vector<std::pair<double, double>>& keys)
+        {
+            static_assert(P::lifeCurves, "speedOverLife requires Features::lifeCurves");
+            property.speedRate.fill(1.0);
+            bakeLifeCurve(keys, property.speedRate);
+            return *this;
+        }
+
+        // 色のグラデーション。keysは「経過率と色」の組。空なら生成時の色のまま（アルファはフェードアウトのみ）
+        Particle& colorOverLife(const std::vector<std::pair<double, ColorF>>& keys)
+        {
+            static_assert(P::lifeCurves, "colorOverLife requires Features::lifeCurves");
+            property.hasLifeColor = !keys.empty();
+            bakeLifeCurve(keys, property.lifeColor);
+            return *this;
+        }
+
+        // 固定容量プール。capacityは最大粒子数（0で可変長に戻す）。以後、粒子配列の再確保は行わない
+        Particle& poolCapacity(size_t capacity, Overflow overflow = Overflow::Reject)
+        {
+            setupPool(elements, capacity, overflow);
+            return *this;
+        }
+
+        // メモリの上限（バイト）。粒子配列がこれを超えない固定容量プールとなる
+        Particle& memoryLimit(size_t bytes, Overflow overflow = Overflow::Reject)
+        {
+            setupPoolByBytes(elements, bytes, overflow);
+            return *this;
+        }
+
+        // 無効な粒子を削除するとき、並び順（＝描画順）を保つかどうか。falseで少し軽量
+        Particle& keepOrder(bool isKeep) { stableOrder = isKeep; return *this; }
+
+        // 粒子の予算（Budget）を使う優先度。低いほど、上限や処理の重さで先に減らされる
+        Particle& budgetPriority(BudgetPriority priority) { budgetTicket.priority = priority; return *this; }
+
+        // 世界の範囲。粒子はウィンドウの代わりに、この範囲（＋余白）の外に出たら無効になる。
+        // スクロールする世界やCamera2Dでは、cameraViewと組み合わせて使う
+        Particle& worldBounds(double left, double top, double right, double bottom)
+        {
+            if (right < left) std::swap(left, right);
+            if (bottom < top) std::swap(top, bottom);
+            world.bounded = true;
+            world.bounds  = toRealRect(left, top, right, bottom);
+            return *this;
+        }
+
+        // 世界の範囲を解除（ウィンドウ、Dotはイメージの範囲に戻す）
+        Particle& clearWorldBounds() { world.bounded = false; return *this; }
+
+        // カメラの視野（Camera2D::getRegionなど）。視野外の粒子は動き続けるが、描画しない。
+        // Dotのイメージは視野の左上に合わせて置く（大きさはウィンドウのまま。ズームアウトではみ出た部分は描画しない）
+        Particle& cameraView(const RectF& view)
+        {
+            world.viewing = true;
+            world.view    = toRealRect(view.leftX(), view.topY(), view.rightX(), view.bottomY());
+            return *this;
+        }
+
+        // カメラの視野を解除
+        Particle& clearCameraView() { world.viewing = false; return *this; }
+
+        // 視野外の粒子を処理する間隔（ステップ数）。2以上なら、視野外の粒子はその間隔ごとにまとめて進める（軽いが粗い）。
+        // 粒子ごとに処理するステップをずらすので、負荷は平均される。cameraViewが無いときは無効
+        Particle& offscreenInterval(int interval)
+        {
+            world.farInterval = std::max(interval, 1);
+            return *this;
+        }
+
+        // 静止した粒子の休止。1ステップの移動量（衝突で戻した後）が、何ステップも続けて小さい粒子が対象で、
+        // 引力で障害物の上に載った粒子も休止する（引力があるときは、障害物に触れてから数え始めるので、宙では休止しない）。休止中は移動と衝突判定を省き、色やサイズの変化と領域外の判定だけを行う。
+        // 動きを変えうるもの（正の加速、力場、乱流、相互作用、サブエミッタ、障害物の変化）があれば自動で起きる。
+        // 休止中の粒子は配列の先頭に集めるので、並び順（＝描画順）は保たれない
+        Particle& sleep(bool isEnable)
+        {
+            isSleep = isEnable;
+            if (!isEnable) sleepQty = 0;
+            return *this;
+        }
+
+        // 固定タイムステップ。stepRateは1秒あたりのステップ数、maxStepQtyは1回のupdateで追いつく上限。
+        // 描画はステップ間の位置を補間するので、高リフレッシュレートでも滑らかに動く
+        Particle& fixedTimestep(bool isFixed, double stepRate = 60.0, int maxStepQty = 4)
+        {
+            setupTimestep(isFixed, stepRate, maxStepQty);
+            return *this;
+        }
+
+        // 乱流（煙や火の粉の渦巻き）。焼き込んだカールノイズの格子を、scroll（1秒あたりのピクセル）で流しながら粒子を押す。
+        // powerは最大の移動量（60FPSの1フレームあたりのピクセル）、cellSizeは格子1マスのピクセル数。powerが0で無効
+        Particle& turbulence(double power, double cellSize = 32.0, Vec2 scroll = Vec2(0, -20), size_t gridSize = 64)
+        {
+            setupTurbulence(power, cellSize, scroll, gridSize);
+            return *this;
+        }
+
+        // サブエミッタ。粒子がtriggerの条件を満たすと、その位置からtargetにquantity個の粒子を生成する（targetは自分でもよい）。
+        // 向きは粒子の移動の向き、速度はtargetの設定値に「粒子の速度 * inheritSpeed」を加えたもの。intervalはSubEmit::Timerの間隔（秒）。
+        // 生成はupdateの最後にまとめて行う。targetはこのインスタンスより長く生きていること
+        template<typename T>
+        Particle& subEmitter(T& target, SubEmit trigger, int quantity, double inheritSpeed = 0.5, double interval = 0.5)
+        {
+            setupSubEmitter(target, trigger, quantity, inheritSpeed, interval);
+            return *this;
+        }
+
+        // サブエミッタの発動を、1回のupdateで何回まで受け付けるか（超えた分は捨てる）。既定は256
+        Particle& subEmitLimit(size_t capacity)
+        {
+            subEmitCapacity = capacity;
+            subEmitEvents.reserve(capacity);
+            return *this;
+        }
+
+        // 衝突の記録。1回のupdateでcapacity個まで記録し、collisionsで読める（0で無効。既定）。
+        // countHitsがtrueなら、障害物ごとの衝突回数も数える（collisionCounts）
+        Particle& recordCollisions(size_t capacity, bool countHits = false)
+        {
+            setupCollisionEvents(capacity, countHits);
+            return *this;
+        }
+
+        // すべてのサブエミッタを解除
+        Particle& clearSubEmitters()
+        {
+            subEmitters.clear();
+            subEmitEvents.clear();
+            return *this;
+        }
+
+        // 粒子同士の相互作用（砂、泡、群れなど）。radius（ピクセル）以内の粒子が押し合う（powerが負なら引き合う）。
+        // 力は「power * (1 - 距離 / radius)^falloff」。neighborLimitは1粒子が調べる近傍の上限。radiusが0以下で無効
+        Particle& interact(double radius, double power, double falloff = 1.0, size_t neighborLimit = 32)
+        {
+            setupInteraction(radius, power, falloff, neighborLimit);
+            return *this;
+        }
+
+        // スムージング（Renderer::Dotのみ）
+        Particle& smoothing(bool isSmooth)
+        {
+            static_assert(P::renderer == Renderer::Dot, "smoothing requires Renderer::Dot");
+            property.samplerState = isSmooth ? s3d::SamplerState::ClampLinear :
+                                               s3d::SamplerState::ClampNearest;
+            return *this;
+        }
+
+        // サブピクセル描画（Renderer::Dotのみ）。点を位置の小数部に応じて周囲の4ドットに分けて打ち、
+        // ゆっくり動く粒子もなめらかに見せる（1粒子あたりの描画は約4倍）
+        Particle& subPixel(bool isSubPixel)
+        {
+            static_assert(P::renderer == Renderer::Dot, "subPixel requires Renderer::Dot");
+            property.isSubPixel = isSubPixel;
+            return *this;
+        }
+
+        // ドットの拡大率。1.0（等倍） ～ 8.0（Renderer::Dotのみ）
+        Particle& dotScale(double scale)
+        {
+            static_assert(P::renderer == Renderer::Dot, "dotScale requires Renderer::Dot");
+            if (property.canvas) return *this;  // 共有キャンバスの拡大率に従う
+            if (scale < 1.0) scale = 1.0;
+            if (scale > 8.0) scale = 8.0;
+
+            // 拡大率はインスタンスごとに比べる（同じ値なら作り直さない）
+            if (static_cast<Real>(scale) != property.dotScale) {
+                endUpdate();
+                property.dotScale = static_cast<Real>(scale);
+                followCanvas(true);  // 新しいサイズのブランクイメージを作る
+            }
+
+            return *this;
+        }
+
+
+        // 共有キャンバス（Renderer::Dotのみ）。drawはキャンバスに点を打つだけになり、クリアと描画はDotCanvasで行う。
+        // 拡大率はキャンバスに従い、自分のイメージとテクスチャは解放する
+        Particle& canvas(DotCanvas& target)
+        {
+            static_assert(P::renderer == Renderer::Dot, "canvas requires Renderer::Dot");
+            endUpdate();
+            property.canvas   = &target;
+            followCanvas();
+            property.img.release();
+            property.blankImg.release();
+            property.tex.release();
+            return *this;
+        }
+
+        // 共有キャンバスを解除（自分のイメージを作り直す）
+        Particle& clearCanvas()
+        {
+            static_assert(P::renderer == Renderer::Dot, "clearCanvas requires Renderer::Dot");
+            endUpdate();
+            if (!property.canvas) return *this;
+            Real scale = property.dotScale;
+            property.canvas   = nullptr;
+            property.dotScale = 0.0;
+            return dotScale(scale);
+        }
+
+
+        // 【メソッド】生成
+        void create(int quantity)
+        {
+            endUpdate();
+            spawn(property.pos, property.radian, property.speed, quantity);
+        }
+
+
+        // 【メソッド】生成（位置と向きを指定。設定は変えない）
+        // サブエミッタからも呼ばれる。速度は設定値にaddSpeedを加えたもの。座標と速度はウィンドウ基準
+        void createFrom(Vec2 pos, double degree, double addSpeed, int quantity)
+        {
+            endUpdate();
+            Real speed = static_cast<Real>(addSpeed);
+            if constexpr (P::renderer == Renderer::Dot) speed *= math.inverseNumber(property.dotScale);
+            spawn(pos, math.toRadian(static_cast<Real>(degree)), property.speed + speed, quantity);
+        }
+
+
+        // 【メソッド】アップデート
+        // 固定タイムステップでは、経過時間に応じて0回以上のステップを処理する
+        void update()
+        {
+            update(s3d::System::DeltaTime());
+        }
+
+
+        // 【メソッド】アップデート（経過時間を指定。メインスレッドで呼ぶ）
+        void update(double deltaSec)
+        {
+            Budget::Meter meter;
+            prepareUpdate();
+            simulate(deltaSec);
+        }
+
+
+        // 【メソッド】非同期アップデートの開始
+        // 今の粒子のバッファを描画用に回し、常駐するスレッドがもう一方のバッファに写してupdateを行う。
+        // endUpdateまでの間、drawは開始時の粒子を描画する（1フレーム前の状態。その間にシミュレーションが進む）。
+        // 例） dot.create(10);  dot.beginUpdate();  ...  dot.draw();  dot.endUpdate();
+        // 実行中に生成、update、セッタ、collisionsなどを呼ぶ場合は、先にendUpdateを呼ぶ（create、updateは自動で待つ）
+        void beginUpdate()
+        {
+            beginUpdate(s3d::System::DeltaTime());
+        }
+
+
+        void beginUpdate(double deltaSec)
+        {
+            Budget::Meter meter;  // メインスレッドの手間だけを計る（別スレッドの時間は、endUpdateで待った分だけ加わる）
+            prepareUpdate();      // 別スレッドはキャンバスに触れない
+
+            // バッファを入れかえる（メインスレッドでは複製しない。elementsは前回の容量を使い回す）
+            elements.swap(snapshot);
+            async.alpha    = timestep.alpha;
+            isDeferSubEmit = true;  // 別のインスタンスへの生成は、endUpdateでメインスレッドから行う
+            async.start(this, [](Works* works, double delta) {
+                Particle* self = static_cast<Particle*>(works);
+                self->elements.assign(self->snapshot.begin(), self->snapshot.end());
+                self->simulate(delta);
+            }, deltaSec);
+        }
+
+
+        // 【メソッド】非同期アップデートの終了（合流点）。実行中でなければ何もしない
+        void endUpdate()
+        {
+            if (!async.running) return;
+            Budget::Meter meter;
+            joinUpdate();
+        }
+
+
+    protected:
+        // 【内部メソッド】粒子が生きられる範囲。この外に出たら無効
+        // Renderer::Dotはイメージの座標（余白を含む。右端と下端は含まない）。それ以外は余白を含み、サイズの分を含まない
+        KotsubuMath::Rect liveRect() const
+        {
+            if constexpr (P::bounds == BoundsMode::Image) {
+                Real margin = WorldMargin / property.dotScale;
+                if (world.bounded) {
+                    Real rate = math.inverseNumber(property.dotScale);
+                    return KotsubuMath::Rect(world.bounds.left * rate - margin, world.bounds.top * rate - margin,
+                                             world.bounds.right * rate + margin, world.bounds.bottom * rate + margin);
+                }
+                // 別スレッドのアップデート中も、メインスレッドが写した値だけを使う（キャンバスの視野や大きさは、実行中に変わりうる）
+                const RealVec2& origin = property.liveOrigin;
+                return KotsubuMath::Rect(origin.x - margin, origin.y - margin,
+                                         origin.x + property.liveSize.x - margin, origin.y + property.liveSize.y - margin);
+            }
+            else {
+                Real margin = WorldMargin;
+                if (world.bounded)
+                    return KotsubuMath::Rect(world.bounds.left - margin, world.bounds.top - margin,
+                                             world.bounds.right + margin, world.bounds.bottom + margin);
+                return KotsubuMath::Rect(-margin, -margin, s3d::Window::Width() + margin, s3d::Window::Height() + margin);
+            }
+        }
+
+
+        // 【内部メソッド】カメラの視野を粒子の座標（Dotはイメージの座標）に直し、余白の分だけ広げたもの
+        KotsubuMath::Rect farRect() const
+        {
+            Real rate   = 1.0;
+            Real margin = WorldMargin;
+            if constexpr (P::bounds == BoundsMode::Image) {
+                rate   = math.inverseNumber(property.dotScale);
+                margin = WorldMargin * rate;
+            }
+            return KotsubuMath::Rect(world.view.left * rate - margin, world.view.top * rate - margin,
+                                     world.view.right * rate + margin, world.view.bottom * rate + margin);
+        }
+
+
+        // 【内部メソッド】カメラの視野の外で、描画しない粒子かどうか（Renderer::Dot以外）
+        bool isCulled(const ParticleElement& r) const
+        {
+            if (!world.viewing) return false;
+            RealVec2 pos    = drawPos(r);
+            Real     margin = WorldMargin;
+            if constexpr (P::sizeOverTime) margin += r.size;
+            return (pos.x < world.view.left - margin) || (pos.x > world.view.right  + margin) ||
+                   (pos.y < world.view.top  - margin) || (pos.y > world.view.bottom + margin);
+        }
+
+
+        // 【内部メソッド】Renderer::Dotのイメージの左上（イメージの座標）
+        // カメラの視野の左上を、イメージの1ドット単位に揃えたもの。視野が無ければ原点
+        RealVec2 canvasOrigin() const
+        {
+            if (property.canvas) return property.canvas->topLeft();
+            if (!world.viewing) return RealVec2(0.0, 0.0);
+            Real rate = math.inverseNumber(property.dotScale);
+            return RealVec2(std::floor(world.view.left * rate), std::floor(world.view.top * rate));
+        }
+
+
+        // 【内部メソッド】Renderer::Dotのイメージを描画する位置（ウィンドウ、またはCamera2Dのワールド座標）
+        Vec2 canvasDrawPos() const
+        {
+            RealVec2 origin = canvasOrigin();
+            return Vec2(origin.x * property.dotScale - WorldMargin, origin.y * property.dotScale - WorldMargin);
+        }
+
+
+        // 【内部メソッド】Renderer::Dotのイメージの、使う範囲の中かどうか
+        // 世界の範囲、カメラの視野、ウィンドウの縮小で、範囲の外にも粒子がいる
+        bool inCanvas(const Point& point) const
+        {
+            const Size& size = property.canvas ? property.canvas->size() : property.viewSize;
+            return (point.x >= 0) && (point.x < size.x) &&
+                   (point.y >= 0) && (point.y < size.y);
+        }
+
+
+        // 【内部メソッド】キャンバスの拡大率と大きさに合わせる（アップデートと生成の前。別スレッドのアップデート中は呼ばない）
+        // 共有キャンバスは後から変わることがあるので写し、自分のイメージはウィンドウの大きさに合わせる。
+        // アップデートが使うキャンバスの左上と大きさも、ここで写す（別スレッドはキャンバスを読まない）
+        void followCanvas(bool isReset = false)
+        {
+            if (property.canvas) {
+                property.dotScale = property.canvas->scale();
+                property.viewSize = property.canvas->size();
+                property.liveSize = property.canvas->capacity();
+            }
+            else {
+                fitCanvas(property.blankImg, property.tex, property.dotScale, property.viewSize, isReset);
+                property.liveSize = Size(property.blankImg.width(), property.blankImg.height());
+            }
+            property.liveOrigin = canvasOrigin();
+        }
+
+
+        // 【内部メソッド】Renderer::Dotの点を打つイメージを用意する
+        // 自分のイメージはクリアして返す。共有キャンバスはDotCanvas::clearでクリア済み
+        Image& beginCanvas()
+        {
+            if (property.canvas) return property.canvas->image();
+            clearDirty(property.img, property.blankImg, property.dirty);  // 前回点を打った範囲だけをクリア
+            return property.img;
+        }
+
+
+        // 【内部メソッド】Renderer::Dotの点を打った範囲（共有キャンバスがあればそちら）
+        DirtyRegion& canvasRegion()
+        {
+            return property.canvas ? property.canvas->dirtyRegion() : property.dirty;
+        }
+
+
+        // 【内部メソッド】Renderer::Dotの動的テクスチャを更新してドロー（共有キャンバスはDotCanvas::drawでまとめて行う）
+        void endCanvas()
+        {
+            if (property.canvas) return;
+            uploadDirty(property.tex, property.img, property.dirty);  // 点を打った範囲だけを転送する
+            s3d::RenderStateBlock2D tmp(property.blendState, property.samplerState);
+            property.tex(0, 0, property.viewSize.x, property.viewSize.y).scaled(property.dotScale).draw(canvasDrawPos());
+        }
+
+
+        // 【内部メソッド】生成の本体。角度の幅や乱れなど、残りは設定値を使う
+        void spawn(RealVec2 pos, Real radian, Real baseSpeed, int quantity)
+        {
+            Real radShake       = (property.radianRange * property.randPow + property.randPow) * Real(0.05);
+            Real radRangeHalf   = property.radianRange * Half;
+            Real speedRandLower = -property.randPow * Half;
+
+            if constexpr (P::renderer == Renderer::Dot) {
+                // 座標をイメージのスケールに合わせる
+                followCanvas();
+                KotsubuMath::Rect live = liveRect();
+                pos *= math.inverseNumber(property.dotScale);
+                if ((pos.x < live.left) || (pos.x >= live.right) || (pos.y < live.top) || (pos.y >= live.bottom))
+                    return;
+            }
+
+            quantity = reserveSpawn(elements, quantity);
+            for (int i = 0; i < quantity; ++i) {
+                // サイズ
+                Real size = Real(0.0);
+                if constexpr (P::sizeOverTime) {
+                    Real sizeRandRange = property.size * property.randPow * Real(0.03);
+                    size = property.size + Random(-sizeRandRange, sizeRandRange);
+                }
+
+                // 角度
+                Real shake = Random(-radShake, radShake) * Random(One) * Random(One);
+                Real range = Random(-radRangeHalf, radRangeHalf);
+                Real rad   = std::fmod(radian + range + shake + TwoPi, TwoPi);
+
+                // スピード
+                Real speed = baseSpeed + Random(speedRandLower, property.randPow);
+
+                // 要素を追加
+                ParticleElement elm(pos, rad, speed, property.color);
+                elm.stepPhase = world.spawnPhase++;
+                if constexpr (P::sizeOverTime)
+                    elm.size = size;
+                if constexpr (P::lifeCurves && P::sizeOverTime)
+                    elm.baseSize = size;
+                if constexpr (P::rotation) {
+                    Real rotateSpeedRange = property.randPow * Real(0.002);
+                    Real rotateSpeed = property.rotateSpeed + Random(-rotateSpeedRange, rotateSpeedRange);
+                    elm.rotateRad   = Random(TwoPi);
+                    elm.rotateSpeed = rotateSpeed;
+                }
+                spawnElement(elements, elm);
+            }
+        }
+
+
+        // 【内部メソッド】アップデートの準備（メインスレッドで行う）
+        // 非同期アップデートを待ち、Renderer::Dotはキャンバスとテクスチャをウィンドウに合わせる
+        void prepareUpdate()
+        {
+            joinUpdate();
+            if constexpr (P::renderer == Renderer::Dot) followCanvas();
+        }
+
+
+        // 【内部メソッド】アップデートの本体（非同期アップデートやManagerでは、別スレッドから呼ぶ）
+        // キャンバスとテクスチャには触れない（先にprepareUpdateを済ませておく）
+        // 予算の計測は、呼んだ側がメインスレッドで行う（並列に動くスレッドの時間を足すと、実際より長くなる）
+        void simulate(double deltaSec)
+        {
+            double stepSec;
+            int    stepQty = beginSteps(deltaSec, stepSec);
+
+            Real scale = 1.0;
+            if constexpr (P::bounds == BoundsMode::Image) scale = property.dotScale;
+            beginCollisionEvents(scale);
+
+            // 休止できるか（障害物の比較は、縮める前の座標で行う）
+            // 引力は妨げない。障害物に載った粒子は、衝突で位置が戻されるので移動量が小さいまま続く
+            beginSleep(property.accelSpeed <= Real(0.0), elements.size());
+
+            // 障害物を、イメージのスケールに合わせる
+            if constexpr (P::renderer == Renderer::Dot)
+                scalingObstacles(property.dotScale);
+
+            for (int i = 0; i < stepQty; ++i)
+                updateStep(stepSec);
+
+            // 障害物をすべて破棄
+            endCollision();
+
+            // サブエミッタの発動記録から、まとめて生成（Managerの並列更新中は、Managerが後で行う）
+            if (!isDeferSubEmit) flushSubEmitters();
+
+            // 粒子の予算に、生存粒子数を知らせる
+            budget.report(budgetTicket, elements.size());
+        }
+
+
+        // 【内部メソッド】非同期アップデートの終了（計測しない。計測中のupdateなどから呼ぶ）
+        void joinUpdate()
+        {
+            if (!async.running) return;
+            async.join();
+            isDeferSubEmit = false;
+            flushSubEmitters();
+        }
+
+
+        // 【内部メソッド】アップデート（1ステップ分）
+        // 機能（Features）ごとの処理はif constexprで分岐するので、使わない処理は残らない
+        void updateStep(double delta)
+        {
+            Real timeScale = static_cast<Real>(delta) / FrameSecOf60Fps;
+            KotsubuMath::Rect live = liveRect();
+
+            // 1ステップあたりの変化量。視野外の粒子は、間引いたステップ数の分をまとめて進める
+            struct Rates
+            {
+                Real      delta, timeScale;
+                Real      accelAlpha;
+                RealColor accelRgb;
+                Real      accelSize, gravityPower, accelSpeed, fadeoutRate, rotateSpeed;
+                Real      gravitySin, gravityCos, turbulencePower;
+            };
+            auto ratesOf = [&](Real stepDelta) {
+                Rates k;
+                k.delta           = stepDelta;
+                k.timeScale       = stepDelta / FrameSecOf60Fps;
+                k.accelAlpha      = property.accelColor.a * k.timeScale;
+                k.accelRgb        = property.accelColor * k.timeScale;  // ColorF型の演算は、アルファは対象外
+                k.accelSize       = Real(0.0);
+                k.gravityPower    = property.gravityPower * k.timeScale;
+                k.accelSpeed      = property.accelSpeed * k.timeScale;
+                k.fadeoutRate     = std::pow(property.fadeoutRate, k.timeScale);
+                k.rotateSpeed     = Real(0.0);
+                k.gravitySin      = Real(0.0);
+                k.gravityCos      = Real(0.0);
+                k.turbulencePower = flowField.power * k.timeScale;
+                if constexpr (P::sizeOverTime)
+                    k.accelSize = property.accelSize * k.timeScale;
+                if constexpr (P::gravity) {
+                    k.gravitySin = std::sin(property.gravityRad) * k.timeScale;
+                    k.gravityCos = std::cos(property.gravityRad) * k.timeScale;
+                }
+                if constexpr (P::rotation)
+                    k.rotateSpeed = property.rotateSpeed * k.timeScale;
+                return k;
+            };
+            const Rates nearRates = ratesOf(static_cast<Real>(delta));
+
+            // 視野外の粒子の間引き
+            bool   isFar       = world.viewing && (world.farInterval > 1);
+            size_t farInterval = static_cast<size_t>(world.farInterval);
+            size_t farPhase    = world.stepCount++ % farInterval;
+            const Rates farRates = isFar ? ratesOf(static_cast<Real>(delta * farInterval)) : nearRates;
+            KotsubuMath::Rect far = farRect();
+
+            // 乱流（Dotはイメージの座標なので、格子とずれをdotScaleで縮める）
+            bool     isTurbulence      = flowField.enable;
+            Real     turbulenceInvCell = One / flowField.cellSize;
+            RealVec2 turbulenceShift   = flowField.offset;
+            scrollTurbulence(delta);
+            if constexpr (P::bounds == BoundsMode::Image) {
+                turbulenceInvCell *= property.dotScale;
+                turbulenceShift   *= math.inverseNumber(property.dotScale);
+            }
+
+            // 色、サイズ、回転などの経過処理（移動以外。休止中の粒子はこれだけを行う）
+            auto ageElement = [&](ParticleElement& r, const Rates& k, Real& moveRate) -> bool {
+                if constexpr (P::lifeCurves) {
+                    // 生存期間の曲線。経過率で表を1回引き、色とサイズを直接決める
+                    r.liveTime += k.delta;
+                    Real age = r.liveTime * property.invLifeSpan;
+                    if (age >= One) {
+                        r.enable = false;
+                        return false;
+                    }
+                    size_t n = static_cast<size_t>(age * LifeCurveResolution);
+
+                    if (r.fadeout) {
+                        r.fade *= k.fadeoutRate;
+                        if (r.fade < FadeoutLimit) {
+                            r.enable = false;
+                            return false;
+                        }
+                        if (!property.hasLifeColor) r.color.a *= k.fadeoutRate;
+                    }
+                    else if constexpr (P::fade == FadeMode::Timed) {
+                        r.fadeout = (r.liveTime > property.fadeoutTime);
+                    }
+
+                    if (property.hasLifeColor) {
+                        r.color = property.lifeColor[n];
+                        r.color.a *= r.fade;
+                    }
+                    if constexpr (P::sizeOverTime)
+                        r.size = r.baseSize * property.sizeRate[n];
+                    moveRate *= property.speedRate[n];
+                }
+                else {
+                    if (r.fadeout) {
+                        // フェードアウト
+                        r.color.a *= k.fadeoutRate;
+                        if (r.color.a < FadeoutLimit) {
+                            r.enable = false;
+                            return false;
+                        }
+                    }
+                    else {
+                        // アルファの変化
+                        r.color.a += k.accelAlpha;
+                        if (r.color.a < Real(0.0) && property.accelColor.a < Real(0.0)) {
+                            r.enable = false;
+                            return false;
+                        }
+                        // 生存時間を累積
+                        if constexpr (P::fade == FadeMode::Timed) {
+                            r.liveTime += k.delta;
+                            r.fadeout = (r.liveTime > property.fadeoutTime);
+                        }
+                    }
+
+                    // RGBの変化
+                    r.color += k.accelRgb;
+
+                    // サイズの変化
+                    if constexpr (P::sizeOverTime) {
+                        r.size += k.accelSize;
+                        if (r.size < Real(0.0)) {
+                            r.enable = false;
+                            return false;
+                        }
+                    }
+                }
+
+                // 回転
+                if constexpr (P::rotation) {
+                    r.rotateRad += k.rotateSpeed;
+                    if ((r.rotateRad < Real(0.0)) || (r.rotateRad >= TwoPi))
+                        r.rotateRad = std::fmod(r.rotateRad, TwoPi);
+                }
+
+                return true;
+            };
+
+            // 静止しているかどうか（移動量の小さいステップが続いた）
+            auto isResting = [](const ParticleElement& r) -> bool { return r.quietSteps >= SleepSteps; };
+            size_t restingQty = 0;
+
+            // 視野外の粒子は、自分の番のステップだけ処理する（番は生成時の位相でずらす）。番でなければnullptr
+            auto ratesFor = [&](const ParticleElement& r) -> const Rates* {
+                if (!isFar || ((r.pos.x >= far.left) && (r.pos.x <= far.right) && (r.pos.y >= far.top) && (r.pos.y <= far.bottom)))
+                    return &nearRates;
+                if ((r.stepPhase + farPhase) % farInterval != 0) return nullptr;
+                return &farRates;
+            };
+
+            // 領域外の判定（休止中の粒子も行う。世界の範囲やウィンドウの大きさは変わることがある）
+            auto inLive = [&](ParticleElement& r) -> bool {
+                if constexpr (P::bounds == BoundsMode::Image) {
+                    // posはイメージ配列の添え字になるので慎重に（世界の範囲が無いときは、イメージの範囲）
+                    if ((r.pos.x < live.left) || (r.pos.x >= live.right) ||
+                        (r.pos.y < live.top)  || (r.pos.y >= live.bottom)) {
+                        r.enable = false;
+                        return false;
+                    }
+                }
+                else {
+                    Real sizeMargin = Real(0.0);
+                    if constexpr (P::sizeOverTime) sizeMargin = r.size;
+                    if ((r.pos.x < live.left - sizeMargin) || (r.pos.x > live.right  + sizeMargin) ||
+                        (r.pos.y < live.top  - sizeMargin) || (r.pos.y > live.bottom + sizeMargin)) {
+                        r.enable = false;
+                        return false;
+                    }
+                }
+                return true;
+            };
+
+            // 経過処理、衝突判定、無効な粒子の削除
+            updateElements(elements, [&](ParticleElement& r) {
+                const Rates* k = ratesFor(r);
+                if (!k) return false;
+
+                // 前のステップの移動量（衝突で戻した後）が小さければ、静かなステップとして数える。
+                // 障害物に載った粒子は、引力の1ステップ分だけ揺れ続けるので、その分を許す。
+                // 引力があるときは、数え始めを衝突した直後（引力がリセットされている）に限る（放物線の頂点で眠らない）
+                if (canSleep) {
+                    RealVec2 move  = r.pos - r.oldPos;
+                    Real     limit = SleepDistance * k->timeScale + k->gravityPower;
+                    bool     still = (move.x * move.x + move.y * move.y) <= (limit * limit);
+                    bool     touch = true;
+                    if constexpr (P::gravity) touch = (r.gravity == Real(0.0));
+                    if (!still || (r.quietSteps == 0 && !touch))
+                        r.quietSteps = 0;
+                    else
+                        r.quietSteps = static_cast<uint8>(std::min(r.quietSteps + 1, int(SleepSteps)));
+                }
+
+                Real moveRate = k->timeScale;
+                if (!ageElement(r, *k, moveRate)) return false;
+
+                // 移動
+                r.oldPos = r.pos;
+                r.pos.x += std::cos(r.radian) * r.speed * moveRate;
+                r.pos.y += std::sin(r.radian) * r.speed * moveRate;
+
+                // 引力
+                if constexpr (P::gravity) {
+                    r.gravity += k->gravityPower;
+                    r.pos.x += k->gravityCos * r.gravity;
+                    r.pos.y += k->gravitySin * r.gravity;
+                }
+
+                // 乱流
+                if (isTurbulence)
+                    r.pos += sampleTurbulence(r.pos, turbulenceInvCell, turbulenceShift) * k->turbulencePower;
+
+                // 領域外の判定
+                if (!inLive(r)) return false;
+
+                // スピードの変化
+                r.speed += k->accelSpeed;
+                if (r.speed < Real(0.0)) r.speed = Real(0.0);
+
+                if (canSleep && isResting(r)) ++restingQty;
+                return true;
+            },
+            [&](ParticleElement& r) {
+                // 休止中の粒子。視野外の間引きと領域外の判定は、動く粒子と同じ
+                const Rates* k = ratesFor(r);
+                if (!k) return true;
+                Real moveRate = k->timeScale;
+                return ageElement(r, *k, moveRate) && inLive(r);
+            }, FrameSecOf60Fps / static_cast<Real>(delta));
+
+            // 静止した粒子を休止させる
+            if (restingQty > 0) gatherSleepers(elements, isResting);
+
+            // 力場と、粒子同士の相互作用（次のステップの移動に反映）
+            applyForceFields(elements, timeScale);
+            Real scale = 1.0;
+            if constexpr (P::bounds == BoundsMode::Image) scale = property.dotScale;
+            interactElements(elements, timeScale, scale);
+        }
+
+
+    public:
+        // 【メソッド】ドロー
+        void draw()
+        {
+            Budget::Meter meter;
+            if constexpr (P::renderer == Renderer::Dot) {
+                // イメージを用意（共有キャンバスはクリア済み）
+                Image& img = beginCanvas();
+                DirtyRegion& dirty = canvasRegion();
+
+                // 余白をスケーリングし、イメージの左上に合わせる
+                Real margin = WorldMargin / property.dotScale;
+                RealVec2 adjustPos = RealVec2(margin, margin) - canvasOrigin();
+
+                // イメージを作成（粒子の数だけ処理。イメージの外の粒子は飛ばす）
+                for (auto& r : shownElements()) {
+                    RealVec2 pos = drawPos(r) + adjustPos;
+                    if (property.isSubPixel) {
+                        splatDot<false>(img, pos, s3d::Color(ColorF(r.color)), dirty);
+                        continue;
+                    }
+                    Point point = pos.asPoint();
+                    if (!inCanvas(point)) continue;  // 世界の範囲、視野、キャンバスの変更で、イメージの外にも粒子がいる
+                    img[point].set(s3d::Color(ColorF(r.color)));  // RealColorがColorF32のときは、ColorFを経由する
+                    dirty.add(point);
+                }
+
+                // 動的テクスチャを更新してドロー（共有キャンバスはDotCanvas::drawでまとめて行う）
+                endCanvas();
+            }
+            else {
+                s3d::RenderStateBlock2D tmp(property.blendState);  // tmpが生きている間だけ有効。破棄時に元に戻る
+
+                for (auto& r : shownElements()) {
+                    if (isCulled(r)) continue;
+                    Real size = 1.0;
+                    Real rotateRad = 0.0;
+                    if constexpr (P::sizeOverTime) size = r.size;
+                    if constexpr (P::rotation) rotateRad = r.rotateRad;
+
+                    if constexpr (P::renderer == Renderer::Circle)
+                        s3d::Circle(drawPos(r), size).draw(r.color);
+                    else
+                        Shape2D::Star(size, drawPos(r), rotateRad).draw(r.color);
+                }
+            }
+        }
+    };
+
+
+
+
+
+    /////////////////////////////////////////////////////////////////////////////////////
+    // 【メインクラス】円形のパーティクル
+    // 円系パーティクルの元となるクラス。他の円系パーティクルはこれを拡張（継承）したもの
+    //
+    using Circle = Particle<CircleFeatures>;
+
+
+
+
+
+    /////////////////////////////////////////////////////////////////////////////////////
+    // 【メインクラス】点のパーティクル
+    // 点系パーティクルの元となるクラス。他の点系パーティクルはこれを拡張（継承）したもの。
+    // 最も多くのパーティクルを描画できる。ただし、このクラスはパーティクル数が
+    // 「0」でも画面全体のイメージを複製＆描画するため、最低負荷は高め。
+    // dotScaleメソッドでドットの拡大率が指定でき、粗いほど負荷を低減できる（1.0 ～ 8.0倍まで）
+    // ※この仕組みは、図形の描画が重く、ブレンディングも効かないため「点系」のみ
+    //
+    using Dot = Particle<DotFeatures>;
+
+
+
+
+
+    /////////////////////////////////////////////////////////////////////////////////////
+    // 【メインクラス】星のパーティクル
+    // n角形やテクスチャパーティクルの元となるクラス
+    //
+    using Star = Particle<StarFeatures>;
+
+
+
+
+
+    /////////////////////////////////////////////////////////////////////////////////////
+    // 【Circleを継承】淡い光のパーティクル（なめらかだが重い）
+    //
+    class CircleLight : public Circle
+    {
+    public:
+        // 【メソッド】ドロー（オーバーライド）
+        void draw()
+        {
+            Budget::Meter meter;
+            s3d::RenderStateBlock2D tmp(property.blendState);
+
+            for (auto& r : shownElements())
+                if (!isCulled(r))
+                    s3d::Circle(drawPos(r), r.size).drawShadow(Vec2(0, 0), 10.0, 2.0, r.color);
+        }
+    };
+
+
+
+
+
+    /////////////////////////////////////////////////////////////////////////////////////
+    // 【Circleを継承】煙のパーティクル
+    //
+    class CircleSmoke : public Circle
+    {
+    private:
+        // 【追加フィールド】
+        int layerQty;
+
+    public:
+        // 【コンストラクタ】
+        CircleSmoke() : layerQty(5)
+        {}
+
+        // 【セッタ】初期パラメータ。メソッドチェーン方式
+        CircleSmoke& layerQuantity(int qty)
+        { 
+            if (qty < 1)  qty = 1;
+            if (qty > 10) qty = 10;
+            layerQty = qty;
+            return *this;
+        }
+
+        // 【メソッド】ドロー（オーバーライド）
+        void draw()
+        {
+            Budget::Meter meter;
+            s3d::RenderStateBlock2D tmp(property.blendState);
+
+            int qty = budgetLayers(layerQty);
+            for (int i = 0; i < qty; ++i) {
+                Real rate = One - i / static_cast<Real>(qty);
+                for (auto& r : shownElements())
+                    if (!isCulled(r))
+                        s3d::Circle(drawPos(r), r.size * rate).draw(r.color);
+            }
+        }
+    };
+
+
+
+
+
+    /////////////////////////////////////////////////////////////////////////////////////
+    // 【Dotを継承】点のパーティクル（加算合成）
+    //
+    class DotBlended : public Dot
+    {
+    public:
+        // 【メソッド】ドロー（オーバーライド）
+        void draw()
+        {
+            Budget::Meter meter;
+            // イメージを用意（共有キャンバスはクリア済み）
+            Image& img = beginCanvas();
+            DirtyRegion& dirty = canvasRegion();
+
+            // 余白をスケーリングし、イメージの左上に合わせる
+            Real margin = WorldMargin / property.dotScale;
+            RealVec2 adjustPos = RealVec2(margin, margin) - canvasOrigin();
+
+            // イメージを作成（粒子の数だけ処理。イメージの外の粒子は飛ばす）
+            for (auto& r : shownElements()) {
+                // サブピクセル描画は、アルファを掛けた色を4ドットに分けて加算
+                RealVec2 pos = drawPos(r) + adjustPos;
+                if (property.isSubPixel) {
+                    splatDot<true>(img, pos, premultiplied(r.color), dirty);
+                    continue;
+                }
+
+                // 現在位置の「余白の-margin分」を補正して添え字化
+                Point point = pos.asPoint();
+                if (!inCanvas(point)) continue;  // 世界の範囲、視野、キャンバスの変更で、イメージの外にも粒子がいる
+                dirty.add(point);
+
+                // 現在位置の色を求める（自前の加算ブレンディング）
+                ColorF src = img[point];
+                ColorF add = r.color;
+                ColorF dst = { src.r + add.r * add.a,
+                               src.g + add.g * add.a,
+                               src.b + add.b * add.a,
+                               src.a + add.a };  // 本来は違うかもしれないが見栄えがよい（キラキラする）
+
+                // 求めた色をセット
+                img[point].set(dst);
+            }
+
+            // 動的テクスチャを更新してドロー（共有キャンバスはDotCanvas::drawでまとめて行う）
+            endCanvas();
+        }
+    };
+
+
+
+
+
+    /////////////////////////////////////////////////////////////////////////////////////
+    // 【Dotを継承】点のパーティクル（しっぽ付き）
+    //
+    class DotTailed : public Dot
+    {
+    public:
+        // 【メソッド】ドロー（オーバーライド）
+        void draw()
+        {
+            Budget::Meter meter;
+            // イメージを用意（共有キャンバスはクリア済み）
+            Image& img = beginCanvas();
+            DirtyRegion& dirty = canvasRegion();
+
+            // 余白をスケーリングし、イメージの左上に合わせる
+            Real margin = WorldMargin / property.dotScale;
+            RealVec2 adjustPos = RealVec2(margin, margin) - canvasOrigin();
+
+            // しっぽの長さを、予算の品質に合わせて短くする
+            Real tailRate = static_cast<Real>(budget.qualityOf(budgetTicket.priority) * 0.99);
+
+            // イメージを作成（粒子の数だけ処理。posが確実にimg[n]の範囲内であること）
+            for (auto& r : shownElements()) {
+                RealVec2 normal = math.normalize(r.pos - r.oldPos);
+                int      len    = static_cast<int>(math.distance(r.pos, r.oldPos) * tailRate);
+                RealVec2 pos    = drawPos(r) + adjustPos;
+                Real     alpha  = r.color.a;
+
+                for (int i = 0; i <= len; ++i) {
+                    // 書き込み位置を添え字化（イメージの外は書かずに、しっぽを続ける）
+                    Point point = pos.asPoint();
+
+                    if (property.isSubPixel) {
+                        splatDot<true>(img, pos, premultiplied(r.color), dirty);
+                    }
+                    else if (inCanvas(point)) {
+                        // 書き込み位置の色を求める（自前の加算ブレンディング）
+                        ColorF src = img[point];
+                        ColorF add = r.color;
+                        ColorF dst = { src.r + add.r * add.a,
+                                       src.g + add.g * add.a,
+                                       src.b + add.b * add.a,
+                                       src.a + add.a };  // 本来は違うかもしれないが見栄えがよい（キラキラする）
+
+                        // 求めた色をセット
+                        img[point].set(dst);
+                        dirty.add(point);
+                    }
+
+                    alpha *= Real(0.925);
+                    if (alpha < FadeoutLimit) break;
+                    pos -= normal;
+                }
+            }
+
+            // 動的テクスチャを更新してドロー（共有キャンバスはDotCanvas::drawでまとめて行う）
+            endCanvas();
+        }
+    };
+
+
+
+
+
+    /////////////////////////////////////////////////////////////////////////////////////
+    // 【メインクラス】点のパーティクル（省メモリ）
+    // Dotと同じ動作を、粒子1個あたり24バイトで行う（Elementはdoubleで約100バイト）。
+    // 百万個単位の粒子を常駐させ、毎フレーム走査する用途向け。
+    // 位置は16.16、速度と引力は8.8の固定小数点、角度は16ビット、色はRGBA8で格納する。
+    // 生存時間は14ビットのミリ秒なので、フェードアウトを始めるまでの時間（fadeoutTime）は約16.4秒までに丸める。
+    // 色や速度の加減値は全粒子で共通なので、端数はインスタンスで1つだけ持ち越す（粒子ごとの誤差は出ない）
+    // Particle<Features>の格納方式にはしない。Particleの各機能（力場、乱流、相互作用、休止、寿命カーブなど）は
+    // ElementのReal値をその場で読み書きするので、固定小数点を格納方式にすると、機能ごとに変換を挟むか処理を二重に持つことになる。
+    // このため、Dotの機能のうち障害物、引力、加速、フェードだけを、固定小数点のまま処理する別クラスとして持つ
+    //
+    class DotCompact : public Works
+    {
+        friend class Manager;
+
+    protected:
+        // クラス内部で使用する構造体
+        struct CompactElement
+        {
+            int32    x, y;          // 位置（16.16固定小数点）
+            int16    moveX, moveY;  // 直前の移動量（8.8固定小数点）。oldPos = pos - move
+            uint16   angle;         // 角度（0 ～ 65535 で 0 ～ 2π）
+            uint16   speed;         // 速度（8.8固定小数点）
+            uint16   gravity;       // 引力（8.8固定小数点）
+            uint16   liveTime : 14; // 生存時間（ミリ秒。LiveTimeMax＝約16.4秒で止まる）
+            uint16   fadeout  : 1;
+            uint16   enable   : 1;
+            s3d::Color color;
+        };
+        static_assert(sizeof(CompactElement) == 24, "CompactElement must be 24 bytes");
+
+
+        struct CompactProperty : public Property, public Element
+        {
+            Real           dotScale;
+            SamplerState   samplerState;
+            DynamicTexture tex;
+            Image          img;
+            Image          blankImg;  // 容量（ウィンドウが小さくなっても作り直さない）
+            DirtyRegion    dirty;     // 点を打った範囲
+            bool           isSubPixel;  // 点を周囲の4ドットに分けて打つ
+            Size           viewSize;  // 使う範囲（点を打つ範囲）
+            CompactProperty() : dotScale(0.0), samplerState(s3d::SamplerState::ClampNearest), isSubPixel(false),
+                viewSize(0, 0)
+            {}
+        };
+
+
+        // 加減値の端数（次のステップに持ち越す）
+        struct Carry
+        {
+            Real r, g, b, a;
+            Real speed;
+            Real gravity;
+            Real liveTime;
+            Carry() : r(0.0), g(0.0), b(0.0), a(0.0), speed(0.0), gravity(0.0), liveTime(0.0)
+            {}
+        };
+
+
+        // 【内部定数】
+        static constexpr int32  PosOne      = 1 << 16;  // 位置（16.16）の1.0
+        static constexpr int32  ValueOne    = 1 << 8;   // 速度、引力、移動量（8.8）の1.0
+        static constexpr uint16 LiveTimeMax = (1 << 14) - 1;  // 生存時間の上限（ミリ秒。約16.4秒）
+        static inline const Real PosRate    = One / PosOne;
+        static inline const Real ValueRate  = One / ValueOne;
+        static inline const Real AngleToRad = TwoPi / Real(65536.0);
+        static inline const Real RadToAngle = Real(65536.0) / TwoPi;
+
+
+        // 【フィールド】
+        CompactProperty property;
+        Carry           carry;
+        uint32          fadeDither;  // フェードアウトの丸めに加える値（ステップごとに変える）
+
+
+        // 【内部メソッド】固定小数点との変換
+        static int32 toPos(Real v) { return static_cast<int32>(std::lround(v * PosOne)); }
+
+        static uint16 toValue(Real v)
+        {
+            long n = std::lround(v * ValueOne);
+            return static_cast<uint16>(std::clamp(n, 0L, 65535L));
+        }
+
+        static uint16 toAngle(Real radian)
+        {
+            return static_cast<uint16>(static_cast<int32>(std::lround(radian * RadToAngle)) & 0xFFFF);
+        }
+
+        static int16 toMove(int32 posMove)
+        {
+            return static_cast<int16>(std::clamp(posMove >> 8, -32768, 32767));
+        }
+
+        static uint8 toChannel(int n) { return static_cast<uint8>(std::clamp(n, 0, 255)); }
+
+
+        // 【内部メソッド】加減値の整数部を取り出し、端数は持ち越す
+        static int takeCarry(Real& rest, Real delta)
+        {
+            rest += delta;
+            Real whole = std::floor(rest);
+            rest -= whole;
+            return static_cast<int>(whole);
+        }
+
+
+        // 【内部メソッド】粒子の位置と、直前の位置
+        static RealVec2 posOf(const CompactElement& element)
+        {
+            return RealVec2(element.x * PosRate, element.y * PosRate);
+        }
+
+        static RealVec2 oldPosOf(const CompactElement& element)
+        {
+            return posOf(element) - RealVec2(element.moveX, element.moveY) * ValueRate;
+        }
+
+
+        // 【内部メソッド】粒子の描画位置を返す（Works::drawPosの省メモリ版）
+        RealVec2 compactDrawPos(const CompactElement& element) const
+        {
+            if (!timestep.fixed) return posOf(element);
+            return posOf(element) - RealVec2(element.moveX, element.moveY) * (ValueRate * (One - timestep.alpha));
+        }
+
+
+        // 【内部メソッド】衝突判定。一時的なElementに展開して、Worksの判定をそのまま使う
+        void collideCompact(CompactElement& r, Real timeScale)
+        {
+            Element elm;
+            elm.pos     = posOf(r);
+            elm.oldPos  = oldPosOf(r);
+            elm.radian  = r.angle * AngleToRad;
+            elm.speed   = r.speed * ValueRate;
+            elm.gravity = r.gravity * ValueRate;
+            elm.fadeout = r.fadeout;
+
+            collideElement(elm, timeScale);
+            if (!elm.enable) {
+                r.enable = false;
+                return;
+            }
+            if (!elm.fadeout) return;  // 衝突すると必ずfadeoutになる。書き戻しによる誤差を避ける
+
+            int32 x = toPos(elm.pos.x);
+            int32 y = toPos(elm.pos.y);
+            r.moveX   = toMove(x - toPos(elm.oldPos.x));
+            r.moveY   = toMove(y - toPos(elm.oldPos.y));
+            r.x       = x;
+            r.y       = y;
+            r.angle   = toAngle(elm.radian);
+            r.speed   = toValue(elm.speed);
+            r.gravity = toValue(elm.gravity);
+            r.fadeout = true;
+        }
+
+
+
+    public:
+        // 【フィールド】
+        std::vector<CompactElement> elements;
+
+
+        // 【コンストラクタ】
+        DotCompact(size_t reserve = 100000) : fadeDither(0)
+        {
+            elements.reserve(reserve);
+            dotScale(3.0);
+        }
+
+
+        // 【セッタ】各初期パラメータ。メソッドチェーン方式
+        DotCompact& pos(         Vec2   pos)    { property.pos          = pos;                                           return *this; }
+        DotCompact& speed(       double speed)  { property.speed        = fixSpeed(static_cast<Real>(speed));            return *this; }
+        DotCompact& color(       ColorF color)  { property.color        = color;                                         return *this; }
+        DotCompact& angle(       double degree) { property.radian       = math.toRadian(static_cast<Real>(degree));      return *this; }
+        DotCompact& angleRange(  double degree) { property.radianRange  = math.toRadianRange(static_cast<Real>(degree)); return *this; }
+        DotCompact& accelSpeed(  double speed)  { property.accelSpeed   = static_cast<Real>(speed);                      return *this; }
+        DotCompact& accelColor(  ColorF color)  { property.accelColor   = color;                                         return *this; }
+        DotCompact& gravity(     double power)  { property.gravityPower = fixGravityPower(static_cast<Real>(power));     return *this; }
+        DotCompact& gravityAngle(double degree) { property.gravityRad   = math.toRadian(static_cast<Real>(degree));      return *this; }
+        DotCompact& random(      double power)  { property.randPow      = fixRandomPower(static_cast<Real>(power));      return *this; }
+        DotCompact& blendState(s3d::BlendState state) { property.blendState = state; return *this; }
+
+        // 固定容量プール。capacityは最大粒子数（0で可変長に戻す）。以後、粒子配列の再確保は行わない
+        DotCompact& poolCapacity(size_t capacity, Overflow overflow = Overflow::Reject)
+        {
+            setupPool(elements, capacity, overflow);
+            return *this;
+        }
+
+        // メモリの上限（バイト）。粒子配列がこれを超えない固定容量プールとなる
+        DotCompact& memoryLimit(size_t bytes, Overflow overflow = Overflow::Reject)
+        {
+            setupPoolByBytes(elements, bytes, overflow);
+            return *this;
+        }
+
+        // 無効な粒子を削除するとき、並び順（＝描画順）を保つかどうか。falseで少し軽量
+        DotCompact& keepOrder(bool isKeep) { stableOrder = isKeep; return *this; }
+
+        // 粒子の予算（Budget）を使う優先度。低いほど、上限や処理の重さで先に減らされる
+        DotCompact& budgetPriority(BudgetPriority priority) { budgetTicket.priority = priority; return *this; }
+
+        // 固定タイムステップ。stepRateは1秒あたりのステップ数、maxStepQtyは1回のupdateで追いつく上限
+        DotCompact& fixedTimestep(bool isFixed, double stepRate = 60.0, int maxStepQty = 4)
+        {
+            setupTimestep(isFixed, stepRate, maxStepQty);
+            return *this;
+        }
+
+        // スムージング
+        DotCompact& smoothing(bool isSmooth)
+        {
+            property.samplerState = isSmooth ? s3d::SamplerState::ClampLinear :
+                                               s3d::SamplerState::ClampNearest;
+            return *this;
+        }
+
+        // サブピクセル描画。点を位置の小数部に応じて周囲の4ドットに分けて打つ
+        DotCompact& subPixel(bool isSubPixel)
+        {
+            property.isSubPixel = isSubPixel;
+            return *this;
+        }
+
+        // ドットの拡大率。1.0（等倍） ～ 8.0
+        DotCompact& dotScale(double scale)
+        {
+            if (scale < 1.0) scale = 1.0;
+            if (scale > 8.0) scale = 8.0;
+
+            if (static_cast<Real>(scale) != property.dotScale) {
+                property.dotScale = static_cast<Real>(scale);
+                fitCanvas(property.blankImg, property.tex, property.dotScale, property.viewSize, true);  // 新しいサイズのブランクイメージを作る
+            }
+
+            return *this;
+        }
+
+
+        // 【メソッド】生成
+        void create(int quantity)
+        {
+            Real radShake       = (property.radianRange * property.randPow + property.randPow) * Real(0.05);
+            Real radRangeHalf   = property.radianRange * Half;
+            Real speedRandLower = -property.randPow * Half;
+            Real margin         = WorldMargin / property.dotScale;
+            RealVec2 pos        = property.pos * math.inverseNumber(property.dotScale);
+
+            if ((pos.x < -margin) || (pos.x >= property.blankImg.width() - margin) ||
+                (pos.y < -margin) || (pos.y >= property.blankImg.height() - margin))
+                return;
+
+            CompactElement elm = {};
+            elm.x      = toPos(pos.x);
+            elm.y      = toPos(pos.y);
+            elm.enable = true;
+            elm.color  = s3d::Color(static_cast<ColorF>(property.color));
+
+            quantity = reserveSpawn(elements, quantity);
+            for (int i = 0; i < quantity; ++i) {
+                // 角度
+                Real shake = Random(-radShake, radShake) * Random(One) * Random(One);
+                Real range = Random(-radRangeHalf, radRangeHalf);
+                elm.angle  = toAngle(property.radian + range + shake + TwoPi);
+
+                // スピード
+                elm.speed = toValue(property.speed + Random(speedRandLower, property.randPow));
+
+                // 要素を追加
+                spawnElement(elements, elm);
+            }
+        }
+
+
+        // 【メソッド】アップデート
+        // 固定タイムステップでは、経過時間に応じて0回以上のステップを処理する
+        void update()
+        {
+            update(s3d::System::DeltaTime());
+        }
+
+
+        // 【メソッド】アップデート（経過時間を指定。メインスレッドで呼ぶ）
+        void update(double deltaSec)
+        {
+            Budget::Meter meter;
+            prepareUpdate();
+            simulate(deltaSec);
+        }
+
+
+    protected:
+        // 【内部メソッド】アップデートの準備（メインスレッドで行う）
+        // ウィンドウの大きさに合わせる（大きくなったときだけイメージを作り直し、テクスチャを解放する）
+        void prepareUpdate()
+        {
+            fitCanvas(property.blankImg, property.tex, property.dotScale, property.viewSize, false);
+        }
+
+
+        // 【内部メソッド】アップデートの本体（Managerでは、別スレッドから呼ぶ）
+        // キャンバスとテクスチャには触れない（先にprepareUpdateを済ませておく）。予算の計測は呼んだ側で行う
+        void simulate(double deltaSec)
+        {
+            double stepSec;
+            int    stepQty = beginSteps(deltaSec, stepSec);
+
+            // 障害物を、イメージのスケールに合わせる
+            scalingObstacles(property.dotScale);
+
+            for (int i = 0; i < stepQty; ++i)
+                updateStep(stepSec);
+
+            // 障害物をすべて破棄
+            endCollision();
+
+            // 粒子の予算に、生存粒子数を知らせる
+            budget.report(budgetTicket, elements.size());
+        }
+
+
+        // 【内部メソッド】アップデート（1ステップ分）
+        // Dot::updateStepと同じ手順。加減値は整数部だけを全粒子に加え、端数は次のステップへ持ち越す
+        void updateStep(double delta)
+        {
+            Real  timeScale   = static_cast<Real>(delta) / FrameSecOf60Fps;
+            Real  margin      = WorldMargin / property.dotScale;
+            int32 worldLeft   = toPos(-margin);
+            int32 worldRight  = toPos(property.blankImg.width() - margin);
+            int32 worldBottom = toPos(property.blankImg.height() - margin);
+            Real  gravitySin  = std::sin(property.gravityRad) * timeScale;
+            Real  gravityCos  = std::cos(property.gravityRad) * timeScale;
+            int   stepR       = takeCarry(carry.r, property.accelColor.r * timeScale * Real(255.0));
+            int   stepG       = takeCarry(carry.g, property.accelColor.g * timeScale * Real(255.0));
+            int   stepB       = takeCarry(carry.b, property.accelColor.b * timeScale * Real(255.0));
+            int   stepA       = takeCarry(carry.a, property.accelColor.a * timeScale * Real(255.0));
+            int   stepGravity = takeCarry(carry.gravity, property.gravityPower * timeScale * ValueOne);
+            int   stepSpeed   = takeCarry(carry.speed, property.accelSpeed * timeScale * ValueOne);
+            int   stepMs      = takeCarry(carry.liveTime, static_cast<Real>(delta * 1000.0));
+            int   fadeoutMs   = static_cast<int>(std::clamp(property.fadeoutTime * Real(1000.0), Real(0.0), Real(LiveTimeMax - 1)));  // 上限で止まる生存時間でも、必ずフェードアウトする
+            int   fadeLimit   = static_cast<int>(std::ceil(FadeoutLimit * Real(255.0)));
+            int64 fadeRate    = std::llround(std::pow(property.fadeoutRate, timeScale) * Real(65536.0));
+            Real  moveRate    = ValueRate * timeScale;
+            bool  isAlphaDown = (property.accelColor.a < Real(0.0));
+
+            // フェードアウトの切り捨てが偏らないよう、丸めに加える値をステップごとに変える（黄金比）
+            fadeDither = (fadeDither + 40503) & 0xFFFF;
+            int64 dither = fadeDither;
+
+            // 経過処理、衝突判定、無効な粒子の削除
+            sweepElements(elements, [&](CompactElement& r) {
+                if (r.fadeout) {
+                    // フェードアウト
+                    r.color.a = static_cast<uint8>((r.color.a * fadeRate + dither) >> 16);
+                    if (r.color.a < fadeLimit) {
+                        r.enable = false;
+                        return false;
+                    }
+                }
+                else {
+                    // アルファの変化
+                    int alpha = r.color.a + stepA;
+                    if (alpha < 0 && isAlphaDown) {
+                        r.enable = false;
+                        return false;
+                    }
+                    r.color.a = toChannel(alpha);
+                    // 生存時間を累積
+                    r.liveTime = std::min(r.liveTime + stepMs, static_cast<int>(LiveTimeMax));
+                    r.fadeout  = (r.liveTime > fadeoutMs);
+                }
+
+                // RGBの変化
+                r.color.r = toChannel(r.color.r + stepR);
+                r.color.g = toChannel(r.color.g + stepG);
+                r.color.b = toChannel(r.color.b + stepB);
+
+                // 引力（移動の前に加算しても、Dotと同じく加算後の値で移動する）
+                r.gravity = static_cast<uint16>(std::min(r.gravity + stepGravity, 65535));
+
+                // 移動
+                Real rad   = r.angle * AngleToRad;
+                Real grav  = r.gravity * ValueRate;
+                int32 move = toPos(std::cos(rad) * r.speed * moveRate + gravityCos * grav);
+                r.x    += move;
+                r.moveX = toMove(move);
+                move    = toPos(std::sin(rad) * r.speed * moveRate + gravitySin * grav);
+                r.y    += move;
+                r.moveY = toMove(move);
+
+                // 領域外の判定（posはイメージ配列の添え字になるので慎重に）
+                if ((r.x < worldLeft) || (r.x >= worldRight) ||
+                    (r.y < worldLeft) || (r.y >= worldBottom)) {
+                    r.enable = false;
+                    return false;
+                }
+
+                // スピードの変化
+                r.speed = static_cast<uint16>(std::clamp(r.speed + stepSpeed, 0, 65535));
+
+                return true;
+            }, [this, delta](CompactElement& r) { collideCompact(r, FrameSecOf60Fps / static_cast<Real>(delta)); });
+        }
+
+
+    public:
+        // 【メソッド】ドロー
+        void draw()
+        {
+            Budget::Meter meter;
+            // イメージの、前回点を打った範囲だけをクリア
+            clearDirty(property.img, property.blankImg, property.dirty);
+
+            // 余白をスケーリング
+            Real margin = WorldMargin / property.dotScale;
+            RealVec2 adjustPos = { margin, margin };
+
+            // イメージを作成（粒子の数だけ処理。posが確実にimg[n]の範囲内であること）
+            for (auto& r : elements) {
+                RealVec2 pos = compactDrawPos(r) + adjustPos;
+                if (property.isSubPixel) {
+                    splatDot<false>(property.img, pos, r.color, property.dirty);
+                    continue;
+                }
+                Point point = pos.asPoint();
+                if ((point.x >= property.viewSize.x) || (point.y >= property.viewSize.y)) continue;  // ウィンドウの縮小で、使う範囲の外にいる
+                property.img[point] = r.color;
+                property.dirty.add(point);
+            }
+
+            // 動的テクスチャの、点を打った範囲だけを更新
+            uploadDirty(property.tex, property.img, property.dirty);
+
+            // 動的テクスチャをドロー
+            s3d::RenderStateBlock2D tmp(property.blendState, property.samplerState);
+            property.tex(0, 0, property.viewSize.x, property.viewSize.y).scaled(property.dotScale).draw(-WorldMargin, -WorldMargin);
+        }
+    };
+
+
+
+
+
+    /////////////////////////////////////////////////////////////////////////////////////
+    // 【Starを継承】正方形のパーティクル
+    //
+    class Rect : public Star
+    {
+    public:
+        // 【メソッド】ドロー（オーバーライド）
+        // s3dにおけるCircleやStarのサイズは「半径 * 2」であるが、Rectのサイズは
+        //「左上を基点とした縦横の長さ」なので、基点が違う上、見かけの大きさは半分となる。
+        // これをCircleなどと処理を共通にするには、Rectが45°のときでも「想定する円」をはみ出ない
+        // ギリギリの大きさにする（想定する円に内接する正方形の大きさ）
+        void draw()
+        {
+            Budget::Meter meter;
+            s3d::RenderStateBlock2D tmp(property.blendState);  // tmpが生きている間だけ有効。破棄時に元に戻る
+
+            for (auto& r : shownElements())
+                if (!isCulled(r))
+                    s3d::RectF(Arg::center = drawPos(r), r.size * RootTwo).rotated(r.rotateRad).draw(r.color);
+        }
+    };
+
+
+
+
+
+    /////////////////////////////////////////////////////////////////////////////////////
+    // 【Starを継承】五角形のパーティクル
+    //
+    class Pentagon : public Star
+    {
+    public:
+        // 【メソッド】ドロー（オーバーライド）
+        void draw()
+        {
+            Budget::Meter meter;
+            s3d::RenderStateBlock2D tmp(property.blendState);  // tmpが生きている間だけ有効。破棄時に元に戻る
+            for (auto& r : shownElements())
+                if (!isCulled(r))
+                    Shape2D::Pentagon(r.size, drawPos(r), r.rotateRad).draw(r.color);
+        }
+    };
+
+
+
+
+
+    /////////////////////////////////////////////////////////////////////////////////////
+    // 【Starを継承】星のパーティクル（フェード）
+    //
+    class StarFade : public Star
+    {
+    protected:
+        // 【追加フィールド】
+        int layerQty;
+
+    public:
+        // 【コンストラクタ】
+        StarFade() : layerQty(5)
+        {}
+
+        // 【セッタ】初期パラメータ。メソッドチェーン方式
+        StarFade& layerQuantity(int qty)
+        { 
+            if (qty < 1)  qty = 1;
+            if (qty > 10) qty = 10;
+            layerQty = qty;
+            return *this;
+        }
+
+        // 【メソッド】ドロー（オーバーライド）
+        void draw()
+        {
+            Budget::Meter meter;
+            s3d::RenderStateBlock2D tmp(property.blendState);
+
+            int qty = budgetLayers(layerQty);
+            for (int i = 0; i < qty; ++i) {
+                Real rate = One - i / static_cast<Real>(qty) * Half;
+                for (auto& r : shownElements())
+                    if (!isCulled(r))
+                        Shape2D::Star(r.size * rate, drawPos(r), r.rotateRad).draw(r.color);
+            }
+        }
+    };
+
+
+
+
+
+    /////////////////////////////////////////////////////////////////////////////////////
+    // 【StarFadeを継承】正方形のパーティクル（フェード）
+    //
+    class RectFade : public StarFade
+    {
+    public:
+        // 【メソッド】ドロー（オーバーライド）
+        void draw()
+        {
+            Budget::Meter meter;
+            s3d::RenderStateBlock2D tmp(property.blendState);
+
+            int qty = budgetLayers(layerQty);
+            for (int i = 0; i < qty; ++i) {
+                Real rate = One - i / static_cast<Real>(qty) * Half;
+                for (auto& r : shownElements())
+                    if (!isCulled(r))
+                        s3d::RectF(Arg::center = drawPos(r), r.size * RootTwo * rate).rotated(r.rotateRad).draw(r.color);
+            }
+        }
+    };
+
+
+
+
+
+    /////////////////////////////////////////////////////////////////////////////////////
+    // 【StarFadeを継承】五角形のパーティクル（フェード）
+    //
+    class PentagonFade : public StarFade
+    {
+    public:
+        // 【メソッド】ドロー（オーバーライド）
+        void draw()
+        {
+            Budget::Meter meter;
+            s3d::RenderStateBlock2D tmp(property.blendState);
+
+            int qty = budgetLayers(layerQty);
+            for (int i = 0; i < qty; ++i) {
+                Real rate = One - i / static_cast<Real>(qty) * Half;
+                for (auto& r : shownElements())
+                    if (!isCulled(r))
+                        Shape2D::Pentagon(r.size * rate, drawPos(r), r.rotateRad).draw(r.color);
+            }
+        }
+    };
+
+
+
+
+
+    /////////////////////////////////////////////////////////////////////////////////////
+    // 【Starを継承】テクスチャのパーティクル
+    //
+    class Texture : public Star
+    {
+    protected:
+        // 【追加フィールド】
+        s3d::Texture tex = s3d::Texture(Emoji(U"🐈"), TextureDesc::Mipped);
+
+
+    public:
+        // 【コンストラクタ】
+        Texture()
+        {
+            property.color      = RealColor(1.0, 1.0, 1.0, 1.0);
+            property.accelColor = RealColor(0.0, 0.0, 0.0, -0.005);
+        }
+
+
+        // 【セッタ】描画するテクスチャーを登録
+        void setTexture(s3d::Texture& texture)
+        {
+            tex = texture;
+        }
+
+
+        // 【メソッド】ドロー（オーバーライド）
+        void draw()
+        {
+            Budget::Meter meter;
+            s3d::RenderStateBlock2D tmp(property.blendState);  // tmpが生きている間だけ有効。破棄時に元に戻る
+            // テクスチャのサイズもRectと同じ仕様。基点を中心で描画するにはdrawAtメソッドを使う。
+            for (auto& r : shownElements())
+                if (!isCulled(r))
+                    tex.resized(r.size * RootTwo).rotated(r.rotateRad).drawAt(drawPos(r), r.color);
+        }
+    };
+
+
+
+
+
+    /////////////////////////////////////////////////////////////////////////////////////
+    // 【クラス】パーティクルのマネージャ
+    // 種類の違うインスタンスをまとめて登録し、updateは複数のスレッドで並列に、drawは描画順に行う。
+    // 1つのインスタンスは1つのスレッドが丸ごと処理するので、小さなインスタンスが多いほど効果がある。
+    // 空いたスレッドは、残っているインスタンスを粒子数の多い順に取りに行く（大きいものが最後に残らない）。
+    // サブエミッタの生成は、別のインスタンスに書き込むため、全員の更新が終わった後に登録順で行う。
+    // 登録したインスタンスは、マネージャより長く生きていること
+    //
+    class Manager
+    {
+    private:
+        // 【内部構造体】登録したインスタンス。型は登録時に決まるので、関数ポインタで呼び分ける（仮想関数は使わない）
+        struct Entry
+        {
+            Works* works;
+            int    drawOrder;  // 描画順（小さいほど先に描画する。同じなら登録順）
+            void (*prepare)(Works* works);                    // アップデートの準備（メインスレッド）
+            void (*simulate)(Works* works, double deltaSec);  // アップデートの本体（別スレッド）
+            void (*draw)(Works* works);
+        };
+
+        // 【内部フィールド】
+        std::vector<Entry>  entries;     // 登録順
+        std::vector<size_t> drawList;    // 描画順に並べた添え字（登録が変わったら作り直す）
+        std::vector<size_t> updateList;  // 粒子数の多い順に並べた添え字（updateのたびに作り直す）
+        bool   isDrawListDirty;
+
+
+        // 【内部メソッド】登録済みの位置（無ければentries.size()）
+        size_t indexOf(const Works* works) const
+        {
+            for (size_t i = 0; i < entries.size(); ++i)
+                if (entries[i].works == works) return i;
+            return entries.size();
+        }
+
+
+    public:
+        // 【コンストラクタ】
+        Manager() : isDrawListDirty(false)
+        {}
+
+
+        // 【メソッド】インスタンスを登録（登録済みなら描画順だけを変える）
+        // drawOrderは描画順。小さいほど先に（奥に）描画する
+        template<typename T>
+        Manager& add(T& instance, int drawOrder = 0)
+        {
+            static_assert(std::is_base_of_v<Works, T>, "Manager::add requires a particle instance");
+            isDrawListDirty = true;
+            size_t i = indexOf(&instance);
+            if (i < entries.size()) {
+                entries[i].drawOrder = drawOrder;
+                return *this;
+            }
+
+            Entry entry;
+            entry.works     = &instance;
+            entry.drawOrder = drawOrder;
+            entry.prepare   = [](Works* works) { static_cast<T*>(works)->prepareUpdate(); };
+            entry.simulate  = [](Works* works, double deltaSec) { static_cast<T*>(works)->simulate(deltaSec); };
+            entry.draw      = [](Works* works) { static_cast<T*>(works)->draw(); };
+            entries.push_back(entry);
+            return *this;
+        }
+
+
+        // 【メソッド】インスタンスの登録を解除
+        Manager& remove(const Works& instance)
+        {
+            size_t i = indexOf(&instance);
+            if (i < entries.size()) {
+                entries.erase(entries.begin() + i);
+                isDrawListDirty = true;
+            }
+            return *this;
+        }
+
+
+        // 【メソッド】すべての登録を解除
+        Manager& clear()
+        {
+            entries.clear();
+            isDrawListDirty = true;
+            return *this;
+        }
+
+
+        // 【セッタ】使うスレッド数（メインスレッドを含む）。0でハードウェアのスレッド数（既定）、1で並列にしない
+        // スレッドはWorkerPoolのものを使う（すべてのManagerで共通）
+        Manager& threads(size_t qty) { WorkerPool::getInstance().threads(qty); return *this; }
+
+
+        // 【ゲッタ】登録しているインスタンスの数
+        size_t size() const { return entries.size(); }
+
+
+        // 【メソッド】すべてのインスタンスをアップデート
+        void update()
+        {
+            update(s3d::System::DeltaTime());
+        }
+
+
+        // 【メソッド】すべてのインスタンスをアップデート（経過時間を指定）
+        void update(double deltaSec)
+        {
+            if (entries.empty()) return;
+            Budget::Meter meter;  // 全体の経過時間を1回だけ計る（インスタンスごとの時間は並列に重なる）
+
+            // 粒子数（前回のupdateの後の数）の多い順に並べる
+            updateList.resize(entries.size());
+            std::iota(updateList.begin(), updateList.end(), size_t(0));
+            std::stable_sort(updateList.begin(), updateList.end(), [this](size_t a, size_t b) {
+                return entries[a].works->budgetTicket.live > entries[b].works->budgetTicket.live;
+            });
+
+            // キャンバスとテクスチャの準備は、メインスレッドで先に済ませる（Siv3Dのリソースは別スレッドで触れない）
+            for (auto& entry : entries) {
+                entry.prepare(entry.works);
+                entry.works->isDeferSubEmit = true;
+            }
+
+            // 空いたスレッドが、次のインスタンスを取りに行く（常駐するプールのスレッドで処理する）
+            WorkerPool::getInstance().run(updateList.size(), [this, deltaSec](size_t n) {
+                Entry& entry = entries[updateList[n]];
+                entry.simulate(entry.works, deltaSec);
+            });
+
+            // サブエミッタの生成（登録順）
+            for (auto& entry : entries) {
+                entry.works->isDeferSubEmit = false;
+                entry.works->flushSubEmitters();
+            }
+        }
+
+
+        // 【メソッド】すべてのインスタンスを描画順にドロー（メインスレッドで呼ぶ）
+        void draw()
+        {
+            if (isDrawListDirty) {
+                drawList.resize(entries.size());
+                std::iota(drawList.begin(), drawList.end(), size_t(0));
+                std::stable_sort(drawList.begin(), drawList.end(), [this](size_t a, size_t b) {
+                    return entries[a].drawOrder < entries[b].drawOrder;
+                });
+                isDrawListDirty = false;
+            }
+
+            for (size_t i : drawList)
+                entries[i].draw(entries[i].works);
+        }
+    };
+}